@@ -0,0 +1,94 @@
+#include <glad/glad.h>
+
+#include <GLFW/glfw3.h>
+#include <cstring>
+#include <iostream>
+
+#include "../classes/gl_extensions.h"
+#include "../classes/headless_context.h"
+#include "bench.h"
+
+struct Benchmark {
+  const char *name;
+  const char *usage;
+  int (*run)(int argc, char **argv);
+};
+
+static const Benchmark benchmarks[] = {
+    {"upload", "upload [size] [iterations]  texture upload throughput, client memory vs. pixel buffer ring", benchUpload},
+    {"shaders", "shaders [programs]          startup compile time, serial vs. batched through ShaderLibrary", benchShaders},
+    {"cull", "cull [boxes] [iterations]     frustum culling cost per box, scalar vs. SIMD", benchCull},
+    {"bvh", "bvh [objects] [iterations]    bounding volume hierarchy build, refit, cull and raycast times", benchBVH},
+    {"jobs", "jobs [entities] [frames]      frame CPU work (transforms, culling, draw list) on 1 to all hardware threads", benchJobs},
+    {"frames", "frames [frames] [WxH] [json] [root]  CubeScene along a scripted camera path: CPU/GPU frame times, draws, state changes", benchFrames},
+    {"golden", "golden [check|update] [root] [out]  renders canonical scenes and compares them with the stored goldens (SSIM, per pixel), heatmaps on failure", benchGolden},
+};
+
+static GLFWwindow *benchWindow = NULL;
+static bool benchHeadless = false;
+static HeadlessContext headlessContext;
+
+bool initBenchContext() {
+  if (benchHeadless)
+    return headlessContext.create(64, 64);
+
+  glfwInit();
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+  glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+  glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+  glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
+
+#ifdef __APPLE__
+  glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+  benchWindow = glfwCreateWindow(64, 64, "bench", NULL, NULL);
+  if (benchWindow == NULL) {
+    std::cout << "Failed to create GLFW window" << std::endl;
+    glfwTerminate();
+    return false;
+  }
+  glfwMakeContextCurrent(benchWindow);
+
+  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return false;
+  }
+  GLExtensions::load((GLADloadproc)glfwGetProcAddress);
+
+  std::cout << "GL_RENDERER " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "GL_VERSION " << glGetString(GL_VERSION) << std::endl;
+  return true;
+}
+
+void shutdownBenchContext() {
+  if (benchHeadless) {
+    headlessContext.destroy();
+    return;
+  }
+  glfwDestroyWindow(benchWindow);
+  glfwTerminate();
+}
+
+int main(int argc, char **argv) {
+  const unsigned int count = sizeof(benchmarks) / sizeof(benchmarks[0]);
+
+  // everything after it runs without a window or display server
+  if (argc >= 2 && strcmp(argv[1], "--headless") == 0) {
+    benchHeadless = true;
+    argc--;
+    argv++;
+  }
+
+  if (argc >= 2) {
+    for (unsigned int i = 0; i < count; i++) {
+      if (strcmp(argv[1], benchmarks[i].name) == 0)
+        return benchmarks[i].run(argc - 2, argv + 2);
+    }
+  }
+
+  std::cout << "usage: bench [--headless] <benchmark> [arguments]" << std::endl;
+  for (unsigned int i = 0; i < count; i++)
+    std::cout << "  " << benchmarks[i].usage << std::endl;
+  return 1;
+}
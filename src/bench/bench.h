@@ -0,0 +1,24 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+
+// creates a hidden window with a GL 3.3 core context, or a headless EGL context after `bench --headless`, and loads GL.
+// Returns false on failure
+bool initBenchContext();
+void shutdownBenchContext();
+
+inline double secondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// each benchmark gets the arguments after its name and returns the process exit code
+int benchUpload(int argc, char **argv);
+int benchShaders(int argc, char **argv);
+int benchCull(int argc, char **argv);
+int benchBVH(int argc, char **argv);
+int benchJobs(int argc, char **argv);
+int benchFrames(int argc, char **argv);
+int benchGolden(int argc, char **argv);
+
+#endif
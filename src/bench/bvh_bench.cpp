@@ -0,0 +1,147 @@
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../classes/bvh.h"
+#include "bench.h"
+
+// runs work `iterations` times and returns the best time in seconds
+template <typename Work> static double best(int iterations, Work work) {
+  double best = 1e30;
+  for (int i = 0; i < iterations; i++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    work();
+    double seconds = secondsSince(start);
+    best = seconds < best ? seconds : best;
+  }
+  return best;
+}
+
+static void report(const char *label, double seconds, const char *unit, double perUnit) {
+  std::cout << "  " << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(3) << std::setw(10) << seconds * 1000.0 << " ms";
+  if (unit != NULL)
+    std::cout << std::setw(12) << std::setprecision(1) << seconds * 1e9 / perUnit << " ns/" << unit;
+  std::cout << std::endl;
+}
+
+// nearest box hit by testing every object, what the tree has to agree with
+static bool raycastAll(const CullingVolumes &volumes, const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) {
+  glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+  bool found = false;
+  for (size_t i = 0; i < volumes.size(); i++) {
+    float distance;
+    if (intersectRayBox(origin, inverseDirection, volumes.center(i) - volumes.extents(i), volumes.center(i) + volumes.extents(i), maxDistance, distance)) {
+      maxDistance = distance;
+      hit.object = (uint32_t)i;
+      hit.distance = distance;
+      found = true;
+    }
+  }
+  return found;
+}
+
+static int benchScene(size_t count, int iterations) {
+  // the scene grows with the object count so the density, and with it the work per query, stays comparable
+  float half = 5.0f * cbrtf((float)count);
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> position(-half, half), extent(0.5f, 2.0f), jitter(-0.5f, 0.5f), unit(-1.0f, 1.0f);
+
+  CullingVolumes volumes;
+  volumes.reserve(count);
+  for (size_t i = 0; i < count; i++)
+    volumes.add(glm::vec3(position(random), position(random), position(random)), glm::vec3(extent(random), extent(random), extent(random)));
+
+  std::cout << count << " objects, best of " << iterations << std::endl;
+  BVH bvh;
+  report("build", best(iterations, [&]() { bvh.build(&volumes); }), "object", (double)count);
+  float builtCost = bvh.sahCost();
+
+  // every object drifts a little, then the whole tree is refitted
+  for (size_t i = 0; i < count; i++)
+    volumes.set(i, volumes.center(i) + glm::vec3(jitter(random), jitter(random), jitter(random)), volumes.extents(i));
+  report("refit all", best(iterations, [&]() { bvh.refit(); }), "object", (double)count);
+
+  // one object in a hundred moves, only their paths to the root are refitted
+  std::vector<uint32_t> changed;
+  for (size_t i = 0; i < count; i += 100)
+    changed.push_back((uint32_t)i);
+  report("refit 1%", best(iterations, [&]() {
+           for (size_t i = 0; i < changed.size(); i++)
+             volumes.centerX[changed[i]] += jitter(random);
+           bvh.refit(&changed[0], changed.size());
+         }),
+         "object", (double)changed.size());
+  std::cout << "  sah cost        " << std::setprecision(2) << builtCost << " built, " << bvh.sahCost() << " refitted" << std::endl;
+
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2.0f * half);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum = Frustum::fromMatrix(projection * view);
+  std::vector<uint32_t> visible(count);
+  size_t flatVisible = 0, treeVisible = 0;
+  report("cull flat", best(iterations, [&]() { flatVisible = volumes.cull(frustum, &visible[0]); }), NULL, 0.0);
+  report("cull bvh", best(iterations, [&]() { treeVisible = bvh.cull(frustum, &visible[0]); }), NULL, 0.0);
+  std::cout << "  visible         " << treeVisible << std::endl;
+  if (flatVisible != treeVisible) {
+    std::cout << "ERROR::BENCH::BVH::CULL_MISMATCH flat " << flatVisible << " bvh " << treeVisible << std::endl;
+    return 1;
+  }
+
+  // rays from random points inside the scene in random directions
+  const int RAYS = 1000, CHECKED_RAYS = 20;
+  std::vector<glm::vec3> origins(RAYS), directions(RAYS);
+  for (int i = 0; i < RAYS; i++) {
+    origins[i] = glm::vec3(position(random), position(random), position(random));
+    directions[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)));
+  }
+  int hits = 0;
+  report("raycast bvh", best(iterations, [&]() {
+           hits = 0;
+           for (int i = 0; i < RAYS; i++) {
+             RayHit hit;
+             hits += bvh.raycast(origins[i], directions[i], 1e30f, hit);
+           }
+         }),
+         "ray", (double)RAYS);
+  std::vector<RayHit> flatHits(CHECKED_RAYS);
+  std::vector<bool> flatFound(CHECKED_RAYS);
+  report("raycast flat", best(1, [&]() {
+           for (int i = 0; i < CHECKED_RAYS; i++)
+             flatFound[i] = raycastAll(volumes, origins[i], directions[i], 1e30f, flatHits[i]);
+         }),
+         "ray", (double)CHECKED_RAYS);
+  for (int i = 0; i < CHECKED_RAYS; i++) {
+    RayHit hit;
+    bool found = bvh.raycast(origins[i], directions[i], 1e30f, hit);
+    if (found != flatFound[i] || (found && hit.distance != flatHits[i].distance)) {
+      std::cout << "ERROR::BENCH::BVH::RAY_MISMATCH ray " << i << std::endl;
+      return 1;
+    }
+  }
+  std::cout << "  rays hit        " << hits << " of " << RAYS << std::endl;
+  return 0;
+}
+
+int benchBVH(int argc, char **argv) {
+  size_t count = argc > 0 ? (size_t)atol(argv[0]) : 0;
+  int iterations = argc > 1 ? atoi(argv[1]) : 5;
+  if ((argc > 0 && count == 0) || iterations <= 0) {
+    std::cout << "ERROR::BENCH::INVALID_ARGUMENTS" << std::endl;
+    return 1;
+  }
+
+  if (count > 0)
+    return benchScene(count, iterations);
+
+  // without a count, the sizes from a small level up to a large open world
+  const size_t sizes[] = {10000, 100000, 1000000};
+  for (unsigned int i = 0; i < 3; i++) {
+    if (benchScene(sizes[i], iterations) != 0)
+      return 1;
+  }
+  return 0;
+}
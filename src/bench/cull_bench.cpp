@@ -0,0 +1,58 @@
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../classes/frustum_culling.h"
+#include "bench.h"
+
+// runs one culling variant `iterations` times and reports the best time per box, returns the visible count
+template <typename Cull> static size_t measure(const char *label, size_t boxes, int iterations, Cull cull) {
+  double best = 1e30;
+  size_t visible = 0;
+  for (int i = 0; i < iterations; i++) {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    visible = cull();
+    double seconds = secondsSince(start);
+    best = seconds < best ? seconds : best;
+  }
+
+  std::cout << std::left << std::setw(8) << label << std::right << std::fixed << std::setprecision(3) << std::setw(10) << best * 1e9 / boxes << " ns/box  "
+            << std::setprecision(2) << best * 1000.0 << " ms  " << visible << " visible" << std::endl;
+  return visible;
+}
+
+int benchCull(int argc, char **argv) {
+  size_t boxes = argc > 0 ? (size_t)atol(argv[0]) : 1000000;
+  int iterations = argc > 1 ? atoi(argv[1]) : 20;
+  if (boxes == 0 || iterations <= 0) {
+    std::cout << "ERROR::BENCH::INVALID_ARGUMENTS" << std::endl;
+    return 1;
+  }
+
+  // boxes scattered through a cube around the camera, so roughly a sixth of them ends up in view
+  std::mt19937 random(42);
+  std::uniform_real_distribution<float> position(-500.0f, 500.0f), extent(0.5f, 2.0f);
+  CullingVolumes volumes;
+  volumes.reserve(boxes);
+  for (size_t i = 0; i < boxes; i++)
+    volumes.add(glm::vec3(position(random), position(random), position(random)), glm::vec3(extent(random), extent(random), extent(random)));
+
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum = Frustum::fromMatrix(projection * view);
+
+  std::vector<uint32_t> visible(boxes);
+  std::cout << boxes << " boxes, best of " << iterations << std::endl;
+  size_t scalar = measure("scalar", boxes, iterations, [&]() { return volumes.cullScalar(frustum, &visible[0]); });
+  size_t simd = measure("simd", boxes, iterations, [&]() { return volumes.cull(frustum, &visible[0]); });
+
+  if (scalar != simd) {
+    std::cout << "ERROR::BENCH::CULL::MISMATCH scalar " << scalar << " simd " << simd << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,189 @@
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../classes/camera_path.hpp"
+#include "../classes/cube_scene.h"
+#include "../classes/framebuffer.h"
+#include "../classes/gl_state_cache.h"
+#include "bench.h"
+
+// simulated seconds per frame, the same for every run whatever the frames cost
+static const float TIMESTEP = 1.0f / 60.0f;
+
+// frames rendered before recording starts: first use of the programs, textures and buffers
+static const unsigned int WARMUP_FRAMES = 10;
+
+// GL_TIME_ELAPSED results are read this many frames late, so reading one does not wait for the GPU
+static const unsigned int QUERY_FRAMES = 4;
+
+struct Distribution {
+  double min, median, p95, p99, mean, max;
+};
+
+// the smallest value with at least p of the values at or below it, ceil(p * n) is its 1 based rank
+static double nearestRank(const std::vector<double> &sorted, double p) {
+  size_t rank = (size_t)std::ceil(p * sorted.size());
+  return sorted[rank == 0 ? 0 : std::min(sorted.size(), rank) - 1];
+}
+
+// nearest rank percentiles
+static Distribution distribution(std::vector<double> values) {
+  Distribution d = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0};
+  if (values.empty())
+    return d;
+  std::sort(values.begin(), values.end());
+  size_t n = values.size();
+  d.min = values[0];
+  d.max = values[n - 1];
+  d.median = values[(n - 1) / 2];
+  d.p95 = nearestRank(values, 0.95);
+  d.p99 = nearestRank(values, 0.99);
+  for (size_t i = 0; i < n; i++)
+    d.mean += values[i];
+  d.mean /= n;
+  return d;
+}
+
+static void printRow(const char *label, const Distribution &d, int precision) {
+  std::cout << "  " << std::left << std::setw(16) << label << std::right << std::fixed << std::setprecision(precision) << std::setw(10) << d.min << std::setw(10)
+            << d.median << std::setw(10) << d.p95 << std::setw(10) << d.p99 << std::setw(10) << d.max << std::setw(10) << d.mean << std::endl;
+}
+
+static void writeJSONDistribution(std::ostream &out, const char *name, const Distribution &d, bool last) {
+  out << "    \"" << name << "\": {\"min\": " << d.min << ", \"median\": " << d.median << ", \"p95\": " << d.p95 << ", \"p99\": " << d.p99 << ", \"max\": " << d.max
+      << ", \"mean\": " << d.mean << "}" << (last ? "" : ",") << "\n";
+}
+
+static std::string escapeJSON(const char *text) {
+  std::string escaped;
+  for (const char *c = text; *c != '\0'; c++) {
+    if (*c == '"' || *c == '\\')
+      escaped += '\\';
+    if ((unsigned char)*c >= 0x20)
+      escaped += *c;
+  }
+  return escaped;
+}
+
+/*
+ Renders CubeScene along CameraPath::cubeFlight() for a fixed number of frames at a fixed timestep into an offscreen
+ framebuffer, and reports per frame CPU time (building and submitting the frame), GPU time (GL_TIME_ELAPSED), draw
+ calls and the state changes that reached the driver. The JSON report holds the same numbers for CI to compare
+ between commits.
+ frames [frames] [WIDTHxHEIGHT] [report.json] [source root]
+*/
+int benchFrames(int argc, char **argv) {
+  unsigned int frames = argc > 0 ? (unsigned int)atoi(argv[0]) : 600;
+  unsigned int width = 1280, height = 720;
+  if (argc > 1 && (sscanf(argv[1], "%ux%u", &width, &height) != 2 || width == 0 || height == 0))
+    frames = 0;
+  const char *reportPath = argc > 2 ? argv[2] : NULL;
+  std::string root = argc > 3 ? argv[3] : DEFAULT_SOURCE_ROOT;
+  if (root.empty() || root[root.size() - 1] != '/')
+    root += '/';
+  if (frames == 0) {
+    std::cout << "ERROR::BENCH::INVALID_ARGUMENTS" << std::endl;
+    return 1;
+  }
+
+  if (!initBenchContext())
+    return 1;
+
+  int result = 0;
+  {
+    Framebuffer target;
+    if (!target.create(width, height)) {
+      shutdownBenchContext();
+      return 1;
+    }
+
+    JobSystem jobs(CubeScene::jobThreads());
+    CubeScene scene(root, jobs);
+    scene.finishLoading();
+    glEnable(GL_DEPTH_TEST);
+
+    Camera camera;
+    camera.SetPerspective((float)width / (float)height, 0.1f, 100.0f);
+    CameraPath path = CameraPath::cubeFlight();
+
+    unsigned int queries[QUERY_FRAMES];
+    glGenQueries(QUERY_FRAMES, queries);
+
+    unsigned int total = WARMUP_FRAMES + frames;
+    std::vector<double> cpuMs(total), gpuMs(total), drawCalls(total), stateChanges(total);
+    for (unsigned int frame = 0; frame < total; frame++) {
+      unsigned int slot = frame % QUERY_FRAMES;
+      if (frame >= QUERY_FRAMES) {
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &nanoseconds);
+        gpuMs[frame - QUERY_FRAMES] = nanoseconds / 1e6;
+      }
+
+      float time = frame * TIMESTEP;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+      path.apply(camera, fmodf(time, path.duration()));
+      scene.renderFrame(camera, time, TIMESTEP);
+      glEndQuery(GL_TIME_ELAPSED);
+      cpuMs[frame] = secondsSince(start) * 1000.0;
+
+      drawCalls[frame] = scene.renderQueue.stats.drawCalls;
+      stateChanges[frame] = GLStateCache::issued;
+      scene.resetFrameStats();
+    }
+    for (unsigned int frame = total > QUERY_FRAMES ? total - QUERY_FRAMES : 0; frame < total; frame++) {
+      GLuint64 nanoseconds = 0;
+      glGetQueryObjectui64v(queries[frame % QUERY_FRAMES], GL_QUERY_RESULT, &nanoseconds);
+      gpuMs[frame] = nanoseconds / 1e6;
+    }
+    glDeleteQueries(QUERY_FRAMES, queries);
+
+    // only the recorded frames
+    cpuMs.erase(cpuMs.begin(), cpuMs.begin() + WARMUP_FRAMES);
+    gpuMs.erase(gpuMs.begin(), gpuMs.begin() + WARMUP_FRAMES);
+    drawCalls.erase(drawCalls.begin(), drawCalls.begin() + WARMUP_FRAMES);
+    stateChanges.erase(stateChanges.begin(), stateChanges.begin() + WARMUP_FRAMES);
+    Distribution cpu = distribution(cpuMs), gpu = distribution(gpuMs), draws = distribution(drawCalls), changes = distribution(stateChanges);
+
+    std::cout << frames << " frames at " << width << "x" << height << ", " << TIMESTEP * 1000.0f << " ms timestep" << std::endl;
+    std::cout << "                       min    median       p95       p99       max      mean" << std::endl;
+    printRow("cpu ms", cpu, 3);
+    printRow("gpu ms", gpu, 3);
+    printRow("draw calls", draws, 1);
+    printRow("state changes", changes, 1);
+
+    if (reportPath != NULL) {
+      std::ofstream report(reportPath);
+      if (!report) {
+        std::cout << "ERROR::BENCH::REPORT_NOT_WRITTEN " << reportPath << std::endl;
+        result = 1;
+      } else {
+        report << std::fixed << std::setprecision(4);
+        report << "{\n  \"benchmark\": \"frames\",\n";
+        report << "  \"renderer\": \"" << escapeJSON((const char *)glGetString(GL_RENDERER)) << "\",\n";
+        report << "  \"frames\": " << frames << ",\n  \"width\": " << width << ",\n  \"height\": " << height << ",\n  \"timestep_ms\": " << TIMESTEP * 1000.0f << ",\n";
+        report << "  \"results\": {\n";
+        writeJSONDistribution(report, "cpu_ms", cpu, false);
+        writeJSONDistribution(report, "gpu_ms", gpu, false);
+        writeJSONDistribution(report, "draw_calls", draws, false);
+        writeJSONDistribution(report, "state_changes", changes, true);
+        report << "  }\n}\n";
+        std::cout << "REPORT " << reportPath << std::endl;
+      }
+    }
+
+    scene.destroy();
+    target.destroy();
+  }
+  shutdownBenchContext();
+  return result;
+}
@@ -0,0 +1,181 @@
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../classes/camera_path.hpp"
+#include "../classes/cube_scene.h"
+#include "../classes/framebuffer.h"
+#include "../classes/gl_state_cache.h"
+#include "../classes/image_compare.h"
+#include "../classes/image_writer.h"
+#include "../classes/shader.h"
+#include "../stb_image.h"
+#include "bench.h"
+
+enum GoldenScene {
+  GOLDEN_TRIANGLE, // shaders/test: one triangle colored by its clip space position
+  GOLDEN_CUBES     // CubeScene seen from CameraPath::cubeFlight() at time
+};
+
+struct GoldenCase {
+  const char *name; // of the golden, goldens/<name>.png under the source root
+  GoldenScene scene;
+  unsigned int width, height;
+  float time;
+  ImageTolerance tolerance;
+};
+
+// the cube textures are minified, so a different GPU filters them differently: more latitude than for the triangle,
+// where only the edges may move
+static const GoldenCase CASES[] = {
+    {"triangle_256x256", GOLDEN_TRIANGLE, 256, 256, 0.0f, {8, 0.01, 0.98}},
+    {"cubes_320x240", GOLDEN_CUBES, 320, 240, 0.0f, {16, 0.01, 0.97}},
+    {"cubes_480x270_flight_2s", GOLDEN_CUBES, 480, 270, 2.0f, {16, 0.01, 0.97}},
+    {"cubes_400x300_flight_5s", GOLDEN_CUBES, 400, 300, 5.0f, {16, 0.01, 0.97}},
+};
+
+// the triangle of the first GL tutorial, in clip space
+static const float TRIANGLE_VERTICES[] = {-0.5f, -0.5f, 0.0f, 0.5f, -0.5f, 0.0f, 0.0f, 0.5f, 0.0f};
+
+static void renderTriangle(Shader &shader) {
+  unsigned int vertexArray, vertexBuffer;
+  glGenVertexArrays(1, &vertexArray);
+  glGenBuffers(1, &vertexBuffer);
+  GLStateCache::bindVertexArray(vertexArray);
+  glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+  glBufferData(GL_ARRAY_BUFFER, sizeof(TRIANGLE_VERTICES), TRIANGLE_VERTICES, GL_STATIC_DRAW);
+  glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void *)0);
+  glEnableVertexAttribArray(0);
+
+  glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  shader.use();
+  glDrawArrays(GL_TRIANGLES, 0, 3);
+
+  GLStateCache::bindVertexArray(0);
+  GLStateCache::forgetVertexArray(vertexArray);
+  glDeleteVertexArrays(1, &vertexArray);
+  glDeleteBuffers(1, &vertexBuffer);
+}
+
+// the bound framebuffer, top row first like the image files
+static void readPixels(unsigned int width, unsigned int height, std::vector<unsigned char> &pixels) {
+  size_t stride = (size_t)width * 4;
+  std::vector<unsigned char> rows(stride * height);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &rows[0]);
+  pixels.resize(rows.size());
+  for (unsigned int y = 0; y < height; y++)
+    memcpy(&pixels[y * stride], &rows[(height - 1 - y) * stride], stride);
+}
+
+static bool loadGolden(const std::string &path, unsigned int width, unsigned int height, std::vector<unsigned char> &pixels) {
+  // texture.hpp turns flipping on for every load on this thread
+  stbi_set_flip_vertically_on_load_thread(false);
+  int goldenWidth, goldenHeight, channels;
+  unsigned char *data = stbi_load(path.c_str(), &goldenWidth, &goldenHeight, &channels, 4);
+  if (data == NULL)
+    return false;
+  bool matches = goldenWidth == (int)width && goldenHeight == (int)height;
+  if (matches)
+    pixels.assign(data, data + (size_t)width * height * 4);
+  stbi_image_free(data);
+  return matches;
+}
+
+/*
+ Renders canonical scenes offscreen at fixed sizes and compares them with the goldens stored under goldens/ in the
+ source root, so a change meant only to make rendering faster (batching, culling, state caching) can be shown not to
+ change what is drawn. A case fails when more pixels than its tolerance allows differ, or when the SSIM drops below
+ its minimum; the render and a heatmap of the differences are then written to the output directory. update
+ overwrites the goldens with the current renders instead. The exit code is the number of failed cases.
+ golden [check|update] [source root] [output directory]
+*/
+int benchGolden(int argc, char **argv) {
+  bool update = argc > 0 && strcmp(argv[0], "update") == 0;
+  if (argc > 0 && !update && strcmp(argv[0], "check") != 0) {
+    std::cout << "ERROR::BENCH::INVALID_ARGUMENTS" << std::endl;
+    return 1;
+  }
+  std::string root = argc > 1 ? argv[1] : DEFAULT_SOURCE_ROOT;
+  if (root.empty() || root[root.size() - 1] != '/')
+    root += '/';
+  std::string output = argc > 2 ? argv[2] : ".";
+  if (output[output.size() - 1] != '/')
+    output += '/';
+
+  if (!initBenchContext())
+    return 1;
+
+  int failures = 0;
+  {
+    JobSystem jobs(CubeScene::jobThreads());
+    CubeScene scene(root, jobs);
+    scene.finishLoading();
+    Shader triangleShader((root + "shaders/test/vertex.glsl").c_str(), (root + "shaders/test/fragment.glsl").c_str());
+    glEnable(GL_DEPTH_TEST);
+
+    CameraPath path = CameraPath::cubeFlight();
+    const unsigned int count = sizeof(CASES) / sizeof(CASES[0]);
+    for (unsigned int i = 0; i < count; i++) {
+      const GoldenCase &test = CASES[i];
+      Framebuffer target;
+      if (!target.create(test.width, test.height)) {
+        failures++;
+        continue;
+      }
+
+      if (test.scene == GOLDEN_TRIANGLE) {
+        renderTriangle(triangleShader);
+      } else {
+        Camera camera;
+        camera.SetPerspective((float)test.width / (float)test.height, 0.1f, 100.0f);
+        path.apply(camera, test.time);
+        scene.renderFrame(camera, test.time, 0.0f);
+      }
+      std::vector<unsigned char> actual;
+      readPixels(test.width, test.height, actual);
+      target.destroy();
+
+      std::string golden = root + "goldens/" + test.name + ".png";
+      if (update) {
+        if (writePNG(golden.c_str(), &actual[0], test.width, test.height))
+          std::cout << "GOLDEN::UPDATED " << golden << std::endl;
+        else
+          failures++;
+        continue;
+      }
+
+      std::vector<unsigned char> expected;
+      if (!loadGolden(golden, test.width, test.height, expected)) {
+        std::cout << "GOLDEN::FAIL " << test.name << " NO GOLDEN AT " << test.width << "x" << test.height << " IN " << golden << ", run golden update" << std::endl;
+        failures++;
+        continue;
+      }
+
+      ImageComparison comparison = compareImages(&actual[0], &expected[0], test.width, test.height, test.tolerance);
+      double differentPercent = 100.0 * comparison.differentPixels / ((double)test.width * test.height);
+      std::cout << (comparison.passed ? "GOLDEN::PASS " : "GOLDEN::FAIL ") << std::left << std::setw(26) << test.name << std::right << std::fixed
+                << " SSIM " << std::setprecision(5) << comparison.ssim << " DIFFERENT " << std::setprecision(3) << differentPercent << "% MAX "
+                << comparison.maxDifference << " MEAN " << comparison.meanDifference << std::endl;
+      if (!comparison.passed) {
+        std::vector<unsigned char> heatmap;
+        differenceHeatmap(&expected[0], comparison, test.width, test.height, test.tolerance.threshold, heatmap);
+        writePNG((output + test.name + ".actual.png").c_str(), &actual[0], test.width, test.height);
+        writePNG((output + test.name + ".diff.png").c_str(), &heatmap[0], test.width, test.height);
+        std::cout << "  written " << output << test.name << ".actual.png and .diff.png" << std::endl;
+        failures++;
+      }
+    }
+
+    triangleShader.destroy();
+    scene.destroy();
+  }
+  shutdownBenchContext();
+  return failures;
+}
@@ -0,0 +1,138 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "../classes/frustum_culling.h"
+#include "../classes/job_system.h"
+#include "../classes/transform_system.h"
+#include "bench.h"
+
+struct FrameTimes {
+  double animate, transforms, bounds, cull, drawList;
+  double total() const { return animate + transforms + bounds + cull + drawList; }
+};
+
+/*
+ The CPU side of a frame for a scene of spinning cubes, every stage spread over the threads of jobs: the animation
+ writes new rotations, the transform system rebuilds the world matrices, the boxes follow them, the boxes are culled
+ and the visible matrices are gathered into an instance array, which is what the GL thread would upload.
+*/
+static size_t runFrames(JobSystem &jobs, size_t entities, int frames, FrameTimes &best) {
+  std::mt19937 random(42);
+  float half = 5.0f * cbrtf((float)entities);
+  std::uniform_real_distribution<float> position(-half, half), unit(-1.0f, 1.0f);
+
+  TransformSystem transforms;
+  CullingVolumes bounds;
+  std::vector<glm::vec3> axes(entities);
+  for (size_t i = 0; i < entities; i++) {
+    transforms.create(glm::vec3(position(random), position(random), position(random)));
+    axes[i] = glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + glm::vec3(0.0f, 0.0f, 2.0f));
+  }
+  transforms.update();
+  for (size_t i = 0; i < entities; i++)
+    bounds.add(transforms.world[i], glm::vec3(0.5f));
+
+  glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 2.0f * half);
+  glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+  Frustum frustum = Frustum::fromMatrix(projection * view);
+
+  std::vector<uint32_t> changed(entities), visible(entities);
+  std::vector<glm::mat4> instances(entities);
+  size_t visibleCount = 0;
+  best.animate = best.transforms = best.bounds = best.cull = best.drawList = 1e30;
+
+  for (int frame = 0; frame < frames; frame++) {
+    float angle = 0.01f * (frame + 1);
+
+    // split at multiples of 64 entities, the dirty bits of one word must not be written by two threads
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    jobs.parallelFor((uint32_t)((entities + 63) / 64), 16, [&](uint32_t begin, uint32_t end) {
+      for (size_t i = begin * 64; i < std::min<size_t>(end * 64, entities); i++) {
+        glm::quat rotation = glm::angleAxis(angle, axes[i]);
+        transforms.rotationX[i] = rotation.x;
+        transforms.rotationY[i] = rotation.y;
+        transforms.rotationZ[i] = rotation.z;
+        transforms.rotationW[i] = rotation.w;
+        transforms.markDirty((uint32_t)i);
+      }
+    });
+    best.animate = std::min(best.animate, secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    size_t changedCount = transforms.update(&changed[0], &jobs);
+    best.transforms = std::min(best.transforms, secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    jobs.parallelFor((uint32_t)changedCount, 4096, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++)
+        bounds.set(changed[i], transforms.world[changed[i]], glm::vec3(0.5f));
+    });
+    best.bounds = std::min(best.bounds, secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    visibleCount = bounds.cull(frustum, &visible[0], jobs);
+    best.cull = std::min(best.cull, secondsSince(start));
+
+    start = std::chrono::steady_clock::now();
+    jobs.parallelFor((uint32_t)visibleCount, 4096, [&](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++)
+        instances[i] = transforms.world[visible[i]];
+    });
+    best.drawList = std::min(best.drawList, secondsSince(start));
+  }
+  return visibleCount;
+}
+
+int benchJobs(int argc, char **argv) {
+  size_t entities = argc > 0 ? (size_t)atol(argv[0]) : 1000000;
+  int frames = argc > 1 ? atoi(argv[1]) : 20;
+  if (entities == 0 || frames <= 0) {
+    std::cout << "ERROR::BENCH::INVALID_ARGUMENTS" << std::endl;
+    return 1;
+  }
+
+  unsigned int hardwareThreads = std::thread::hardware_concurrency();
+  if (hardwareThreads == 0)
+    hardwareThreads = 1;
+  std::vector<unsigned int> threadCounts;
+  for (unsigned int threads = 1; threads < hardwareThreads; threads *= 2)
+    threadCounts.push_back(threads);
+  threadCounts.push_back(hardwareThreads);
+
+  std::cout << entities << " entities, all spinning, best of " << frames << " frames (ms)" << std::endl;
+  std::cout << "threads   animate transforms    bounds      cull draw list     frame  speedup" << std::endl;
+  double serial = 0.0;
+  size_t expectedVisible = 0;
+  for (size_t i = 0; i < threadCounts.size(); i++) {
+    FrameTimes best;
+    size_t visible;
+    uint64_t stolen;
+    {
+      JobSystem jobs(threadCounts[i]);
+      visible = runFrames(jobs, entities, frames, best);
+      stolen = jobs.stolenJobs();
+    }
+    if (i == 0) {
+      serial = best.total();
+      expectedVisible = visible;
+    } else if (visible != expectedVisible) {
+      std::cout << "ERROR::BENCH::JOBS::MISMATCH " << threadCounts[i] << " threads saw " << visible << " visible, 1 thread " << expectedVisible << std::endl;
+      return 1;
+    }
+
+    std::cout << std::setw(7) << threadCounts[i] << std::fixed << std::setprecision(3) << std::setw(10) << best.animate * 1000.0 << std::setw(11)
+              << best.transforms * 1000.0 << std::setw(10) << best.bounds * 1000.0 << std::setw(10) << best.cull * 1000.0 << std::setw(10)
+              << best.drawList * 1000.0 << std::setw(10) << best.total() * 1000.0 << std::setw(8) << std::setprecision(2) << serial / best.total() << "x  "
+              << stolen << " jobs stolen" << std::endl;
+  }
+  std::cout << expectedVisible << " of " << entities << " entities visible" << std::endl;
+  return 0;
+}
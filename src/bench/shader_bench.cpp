@@ -0,0 +1,122 @@
+#include <glad/glad.h>
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../classes/gl_extensions.h"
+#include "../classes/program_binary_cache.h"
+#include "../classes/shader.h"
+#include "../classes/shader_library.hpp"
+#include "../classes/shader_source.h"
+#include "bench.h"
+
+// a fragment shader with enough work in it that compiling it takes the driver a noticeable time. The salt makes
+// every program unique, so neither run is served from the driver's own shader cache
+static std::string fragmentSource(unsigned int salt) {
+  std::ostringstream out;
+  out << "#version 330 core\n"
+      << "in vec2 TexCoord;\n"
+      << "out vec4 FragColor;\n"
+      << "uniform sampler2D texture1;\n";
+
+  for (int f = 0; f < 24; f++) {
+    out << "vec3 layer" << f << "(vec2 uv) {\n"
+        << "  vec3 c = vec3(0.0);\n"
+        << "  for (int i = 0; i < 4; i++) {\n"
+        << "    uv = uv * " << (1.1f + f * 0.01f) << " + vec2(" << salt % 97 << ".0, " << f << ".0) * 0.001;\n"
+        << "    c += texture(texture1, uv).rgb * sin(uv.x * " << (f + 1) << ".0) * cos(uv.y * " << (salt % 13 + 1) << ".0);\n"
+        << "  }\n"
+        << "  return c;\n"
+        << "}\n";
+  }
+
+  out << "void main() {\n"
+      << "  vec3 c = vec3(" << salt << ".0 * 1e-9);\n";
+  for (int f = 0; f < 24; f++)
+    out << "  c += layer" << f << "(TexCoord + c.xy);\n";
+  out << "  FragColor = vec4(c, 1.0);\n"
+      << "}\n";
+  return out.str();
+}
+
+static const char VERTEX_SOURCE[] = "#version 330 core\n"
+                                    "layout (location = 0) in vec3 aPos;\n"
+                                    "layout (location = 1) in vec2 aTexPos;\n"
+                                    "out vec2 TexCoord;\n"
+                                    "void main() {\n"
+                                    "  gl_Position = vec4(aPos, 1.0);\n"
+                                    "  TexCoord = aTexPos;\n"
+                                    "}\n";
+
+static void report(const char *label, unsigned int programs, double seconds) {
+  std::cout << std::left << std::setw(10) << label << std::right << std::fixed << std::setprecision(1) << std::setw(10) << seconds * 1000.0 << " ms  "
+            << std::setprecision(2) << seconds * 1000.0 / programs << " ms/program" << std::endl;
+}
+
+int benchShaders(int argc, char **argv) {
+  unsigned int programs = argc > 0 ? (unsigned int)atoi(argv[0]) : 32;
+  if (programs == 0) {
+    std::cout << "ERROR::BENCH::INVALID_ARGUMENTS" << std::endl;
+    return 1;
+  }
+
+  if (!initBenchContext())
+    return 1;
+  std::cout << "GL_KHR_parallel_shader_compile " << (GLExtensions::parallelShaderCompile ? "yes" : "no") << std::endl;
+
+  // measure the compiler, not the binary cache
+  ProgramBinaryCache::directory.clear();
+
+  // the salts differ between runs of the benchmark too, or a second run would hit the driver's disk cache
+  unsigned int seed = (unsigned int)std::chrono::steady_clock::now().time_since_epoch().count();
+  std::vector<std::string> fragments(programs * 2);
+  for (unsigned int i = 0; i < fragments.size(); i++)
+    fragments[i] = fragmentSource(seed + i);
+
+  ShaderSource vertexSrc;
+  vertexSrc.addText(VERTEX_SOURCE, sizeof(VERTEX_SOURCE) - 1);
+
+  // serial: every program is compiled, linked and checked before the next one is submitted
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  std::vector<Shader *> serial;
+  for (unsigned int i = 0; i < programs; i++) {
+    ShaderSource fragmentSrc;
+    fragmentSrc.addText(fragments[i].data(), fragments[i].size());
+    serial.push_back(new Shader("serial", vertexSrc, fragmentSrc, true));
+  }
+  double serialSeconds = secondsSince(start);
+
+  // batched: everything is submitted first, then polled until the driver is done
+  start = std::chrono::steady_clock::now();
+  ShaderLibrary library;
+  for (unsigned int i = 0; i < programs; i++) {
+    ShaderSource fragmentSrc;
+    fragmentSrc.addText(fragments[programs + i].data(), fragments[programs + i].size());
+    library.add("batched", vertexSrc, fragmentSrc);
+  }
+  double submitSeconds = secondsSince(start);
+  if (GLExtensions::parallelShaderCompile) {
+    while (library.poll() > 0) {
+    }
+  }
+  library.finishAll();
+  double batchedSeconds = secondsSince(start);
+
+  std::cout << programs << " programs" << std::endl;
+  report("serial", programs, serialSeconds);
+  report("submit", programs, submitSeconds);
+  report("batched", programs, batchedSeconds);
+  std::cout << "speedup " << std::setprecision(2) << serialSeconds / batchedSeconds << "x" << std::endl;
+
+  for (size_t i = 0; i < serial.size(); i++) {
+    serial[i]->destroy();
+    delete serial[i];
+  }
+  library.destroy();
+  shutdownBenchContext();
+  return 0;
+}
@@ -0,0 +1,75 @@
+#include <glad/glad.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../classes/gl_extensions.h"
+#include "../classes/pixel_upload_ring.h"
+#include "bench.h"
+
+// uploads the same RGBA image `iterations` times into one texture and reports MB/s, including the time to drain the GPU
+static double measure(const char *label, unsigned int texture, int size, int iterations, const std::vector<unsigned char> &pixels, PixelUploadRing *ring) {
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glFinish();
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; i++) {
+    if (ring == NULL) {
+      glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+      continue;
+    }
+
+    PixelUploadSlot slot = ring->acquire(pixels.size());
+    memcpy(slot.memory, &pixels[0], pixels.size());
+    ring->beginUpload(slot);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, slot.offset);
+    ring->endUpload(slot);
+  }
+  glFinish();
+  double seconds = secondsSince(start);
+
+  double megabytes = (double)pixels.size() * iterations / (1024.0 * 1024.0);
+  std::cout << std::left << std::setw(22) << label << std::right << std::fixed << std::setprecision(1) << std::setw(10) << megabytes / seconds << " MB/s  "
+            << std::setprecision(3) << seconds * 1000.0 / iterations << " ms/upload" << std::endl;
+  return megabytes / seconds;
+}
+
+int benchUpload(int argc, char **argv) {
+  int size = argc > 0 ? atoi(argv[0]) : 2048;
+  int iterations = argc > 1 ? atoi(argv[1]) : 32;
+
+  if (!initBenchContext())
+    return 1;
+
+  std::vector<unsigned char> pixels((size_t)size * size * 4);
+  for (size_t i = 0; i < pixels.size(); i++)
+    pixels[i] = (unsigned char)(i * 31);
+
+  unsigned int texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+  std::cout << "upload " << size << "x" << size << " RGBA8, " << iterations << " iterations" << std::endl;
+
+  measure("client memory", texture, size, iterations, pixels, NULL);
+
+  PixelUploadRing orphaning(pixels.size(), 3, false);
+  measure("pbo ring (orphan)", texture, size, iterations, pixels, &orphaning);
+  orphaning.destroy();
+
+  if (GLExtensions::bufferStorage) {
+    PixelUploadRing persistent(pixels.size(), 3, true);
+    measure("pbo ring (persistent)", texture, size, iterations, pixels, &persistent);
+    persistent.destroy();
+  } else {
+    std::cout << "pbo ring (persistent)  skipped, GL_ARB_buffer_storage not available" << std::endl;
+  }
+
+  glDeleteTextures(1, &texture);
+  shutdownBenchContext();
+  return 0;
+}
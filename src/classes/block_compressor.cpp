@@ -0,0 +1,674 @@
+#include <glad/glad.h>
+
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE4_1__)
+#include <smmintrin.h>
+#endif
+
+#include "block_compressor.h"
+
+const char *blockFormatName(BlockFormat format) {
+  switch (format) {
+  case BLOCK_BC1:
+    return "BC1";
+  case BLOCK_BC3:
+    return "BC3";
+  default:
+    return "BC7";
+  }
+}
+
+GLenum blockInternalFormat(BlockFormat format) {
+  switch (format) {
+  case BLOCK_BC1:
+    return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+  case BLOCK_BC3:
+    return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  default:
+    return GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+}
+
+size_t blockBytes(BlockFormat format) { return format == BLOCK_BC1 ? 8 : 16; }
+
+size_t compressedSize(BlockFormat format, int width, int height) { return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format); }
+
+// one 4x4 block as structure of arrays, so 4 or 8 pixels load straight into a SIMD register
+struct Block {
+  alignas(32) float r[16];
+  alignas(32) float g[16];
+  alignas(32) float b[16];
+  alignas(32) float a[16];
+};
+
+// a set of candidate colors, the palette the block's indices select from
+struct Palette {
+  float r[16], g[16], b[16], a[16];
+  int count;
+};
+
+/*
+ Picks the closest palette entry for every pixel (squared distance, alpha included when useAlpha) and returns
+ the summed error. This is where the encoder spends its time: 16 pixels x up to 16 entries per candidate endpoint pair.
+ The SIMD paths test one entry against 8 (AVX2) or 4 (SSE4.1) pixels at once and keep a running minimum per lane.
+*/
+static float selectIndices(const Block &block, const Palette &palette, bool useAlpha, unsigned char *indices) {
+  float total = 0.0f;
+  float alphaWeight = useAlpha ? 1.0f : 0.0f;
+
+#if defined(__AVX2__)
+  for (int i = 0; i < 16; i += 8) {
+    __m256 r = _mm256_load_ps(block.r + i), g = _mm256_load_ps(block.g + i), b = _mm256_load_ps(block.b + i), a = _mm256_load_ps(block.a + i);
+    __m256 best = _mm256_set1_ps(FLT_MAX);
+    __m256 bestIndex = _mm256_setzero_ps();
+    __m256 weight = _mm256_set1_ps(alphaWeight);
+
+    for (int k = 0; k < palette.count; k++) {
+      __m256 dr = _mm256_sub_ps(r, _mm256_set1_ps(palette.r[k]));
+      __m256 dg = _mm256_sub_ps(g, _mm256_set1_ps(palette.g[k]));
+      __m256 db = _mm256_sub_ps(b, _mm256_set1_ps(palette.b[k]));
+      __m256 da = _mm256_mul_ps(_mm256_sub_ps(a, _mm256_set1_ps(palette.a[k])), weight);
+      __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(dg, dg)), _mm256_add_ps(_mm256_mul_ps(db, db), _mm256_mul_ps(da, da)));
+
+      __m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+      best = _mm256_min_ps(distance, best);
+      bestIndex = _mm256_blendv_ps(bestIndex, _mm256_set1_ps((float)k), closer);
+    }
+
+    alignas(32) float lanes[8], laneIndex[8];
+    _mm256_store_ps(lanes, best);
+    _mm256_store_ps(laneIndex, bestIndex);
+    for (int j = 0; j < 8; j++) {
+      indices[i + j] = (unsigned char)laneIndex[j];
+      total += lanes[j];
+    }
+  }
+#elif defined(__SSE4_1__)
+  for (int i = 0; i < 16; i += 4) {
+    __m128 r = _mm_load_ps(block.r + i), g = _mm_load_ps(block.g + i), b = _mm_load_ps(block.b + i), a = _mm_load_ps(block.a + i);
+    __m128 best = _mm_set1_ps(FLT_MAX);
+    __m128 bestIndex = _mm_setzero_ps();
+    __m128 weight = _mm_set1_ps(alphaWeight);
+
+    for (int k = 0; k < palette.count; k++) {
+      __m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette.r[k]));
+      __m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette.g[k]));
+      __m128 db = _mm_sub_ps(b, _mm_set1_ps(palette.b[k]));
+      __m128 da = _mm_mul_ps(_mm_sub_ps(a, _mm_set1_ps(palette.a[k])), weight);
+      __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_add_ps(_mm_mul_ps(db, db), _mm_mul_ps(da, da)));
+
+      __m128 closer = _mm_cmplt_ps(distance, best);
+      best = _mm_min_ps(distance, best);
+      bestIndex = _mm_blendv_ps(bestIndex, _mm_set1_ps((float)k), closer);
+    }
+
+    alignas(16) float lanes[4], laneIndex[4];
+    _mm_store_ps(lanes, best);
+    _mm_store_ps(laneIndex, bestIndex);
+    for (int j = 0; j < 4; j++) {
+      indices[i + j] = (unsigned char)laneIndex[j];
+      total += lanes[j];
+    }
+  }
+#else
+  for (int i = 0; i < 16; i++) {
+    float best = FLT_MAX;
+    int bestIndex = 0;
+    for (int k = 0; k < palette.count; k++) {
+      float dr = block.r[i] - palette.r[k], dg = block.g[i] - palette.g[k], db = block.b[i] - palette.b[k], da = (block.a[i] - palette.a[k]) * alphaWeight;
+      float distance = dr * dr + dg * dg + db * db + da * da;
+      if (distance < best) {
+        best = distance;
+        bestIndex = k;
+      }
+    }
+    indices[i] = (unsigned char)bestIndex;
+    total += best;
+  }
+#endif
+
+  return total;
+}
+
+// the direction the block's colors vary the most along (power iteration on the covariance matrix), channels 3 or 4
+static void principalAxis(const Block &block, int channels, float *mean, float *axis) {
+  const float *data[4] = {block.r, block.g, block.b, block.a};
+
+  for (int c = 0; c < 4; c++) {
+    mean[c] = 0.0f;
+    for (int i = 0; i < 16; i++)
+      mean[c] += data[c][i];
+    mean[c] /= 16.0f;
+  }
+
+  float covariance[4][4] = {{0}};
+  for (int i = 0; i < 16; i++) {
+    for (int x = 0; x < channels; x++) {
+      for (int y = 0; y < channels; y++)
+        covariance[x][y] += (data[x][i] - mean[x]) * (data[y][i] - mean[y]);
+    }
+  }
+
+  for (int c = 0; c < 4; c++)
+    axis[c] = c < channels ? 1.0f : 0.0f;
+
+  for (int iteration = 0; iteration < 8; iteration++) {
+    float next[4] = {0, 0, 0, 0};
+    for (int x = 0; x < channels; x++) {
+      for (int y = 0; y < channels; y++)
+        next[x] += covariance[x][y] * axis[y];
+    }
+
+    float length = 0.0f;
+    for (int c = 0; c < channels; c++)
+      length += next[c] * next[c];
+    length = sqrtf(length);
+    if (length < 1e-6f)
+      return; // flat block, any axis works
+
+    for (int c = 0; c < channels; c++)
+      axis[c] = next[c] / length;
+  }
+}
+
+// endpoints at the two extremes of the block along its principal axis
+static void axisEndpoints(const Block &block, int channels, float *start, float *end) {
+  float mean[4], axis[4];
+  principalAxis(block, channels, mean, axis);
+
+  const float *data[4] = {block.r, block.g, block.b, block.a};
+  float lo = FLT_MAX, hi = -FLT_MAX;
+  for (int i = 0; i < 16; i++) {
+    float t = 0.0f;
+    for (int c = 0; c < channels; c++)
+      t += (data[c][i] - mean[c]) * axis[c];
+    lo = t < lo ? t : lo;
+    hi = t > hi ? t : hi;
+  }
+
+  for (int c = 0; c < 4; c++) {
+    start[c] = mean[c] + axis[c] * hi;
+    end[c] = mean[c] + axis[c] * lo;
+  }
+}
+
+/*
+ Least squares endpoints for fixed indices: each pixel is modeled as weights[index] * start + (1 - weights[index]) * end.
+ Returns false when the indices do not pin down two endpoints (all pixels on the same weight).
+*/
+static bool refineEndpoints(const Block &block, const unsigned char *indices, const float *weights, float *start, float *end) {
+  const float *data[4] = {block.r, block.g, block.b, block.a};
+  float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+  float ax[4] = {0, 0, 0, 0}, bx[4] = {0, 0, 0, 0};
+
+  for (int i = 0; i < 16; i++) {
+    float wa = weights[indices[i]], wb = 1.0f - wa;
+    aa += wa * wa;
+    ab += wa * wb;
+    bb += wb * wb;
+    for (int c = 0; c < 4; c++) {
+      ax[c] += wa * data[c][i];
+      bx[c] += wb * data[c][i];
+    }
+  }
+
+  float determinant = aa * bb - ab * ab;
+  if (fabsf(determinant) < 1e-6f)
+    return false;
+
+  for (int c = 0; c < 4; c++) {
+    start[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+    end[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    start[c] = start[c] < 0.0f ? 0.0f : (start[c] > 255.0f ? 255.0f : start[c]);
+    end[c] = end[c] < 0.0f ? 0.0f : (end[c] > 255.0f ? 255.0f : end[c]);
+  }
+  return true;
+}
+
+static void writeLE16(unsigned char *out, uint16_t value) {
+  out[0] = (unsigned char)(value & 0xFF);
+  out[1] = (unsigned char)(value >> 8);
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// BC1 color block, also the color half of BC3
+
+static uint16_t to565(const float *color) {
+  int r = (int)(color[0] * 31.0f / 255.0f + 0.5f), g = (int)(color[1] * 63.0f / 255.0f + 0.5f), b = (int)(color[2] * 31.0f / 255.0f + 0.5f);
+  r = r < 0 ? 0 : (r > 31 ? 31 : r);
+  g = g < 0 ? 0 : (g > 63 ? 63 : g);
+  b = b < 0 ? 0 : (b > 31 ? 31 : b);
+  return (uint16_t)((r << 11) | (g << 5) | b);
+}
+
+static void from565(uint16_t value, float *color) {
+  int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+  color[0] = (float)((r << 3) | (r >> 2));
+  color[1] = (float)((g << 2) | (g >> 4));
+  color[2] = (float)((b << 3) | (b >> 2));
+}
+
+// weight of color0 for indices 0..3 in four color mode
+static const float BC1_WEIGHTS[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+
+// quantizes a pair of endpoints, always in four color mode (color0 > color1), and picks the indices. Returns the error
+static float fitColorEndpoints(const Block &block, const float *start, const float *end, uint16_t &color0, uint16_t &color1, unsigned char *indices) {
+  color0 = to565(start);
+  color1 = to565(end);
+  if (color0 < color1) {
+    uint16_t swap = color0;
+    color0 = color1;
+    color1 = swap;
+  }
+
+  float c0[3], c1[3];
+  from565(color0, c0);
+  from565(color1, c1);
+
+  Palette palette;
+  palette.count = color0 == color1 ? 1 : 4;
+  for (int k = 0; k < 4; k++) {
+    float w = BC1_WEIGHTS[k];
+    palette.r[k] = c0[0] * w + c1[0] * (1.0f - w);
+    palette.g[k] = c0[1] * w + c1[1] * (1.0f - w);
+    palette.b[k] = c0[2] * w + c1[2] * (1.0f - w);
+    palette.a[k] = 255.0f;
+  }
+
+  return selectIndices(block, palette, false, indices);
+}
+
+static void encodeColorBlock(const Block &block, unsigned char *out) {
+  float start[4], end[4];
+  axisEndpoints(block, 3, start, end);
+
+  uint16_t color0, color1;
+  unsigned char indices[16];
+  float error = fitColorEndpoints(block, start, end, color0, color1, indices);
+
+  // two rounds of least squares on the chosen indices, kept only when they help
+  for (int iteration = 0; iteration < 2 && color0 != color1; iteration++) {
+    if (!refineEndpoints(block, indices, BC1_WEIGHTS, start, end))
+      break;
+
+    uint16_t refined0, refined1;
+    unsigned char refinedIndices[16];
+    float refinedError = fitColorEndpoints(block, start, end, refined0, refined1, refinedIndices);
+    if (refinedError >= error)
+      break;
+
+    error = refinedError;
+    color0 = refined0;
+    color1 = refined1;
+    memcpy(indices, refinedIndices, 16);
+  }
+
+  uint32_t bits = 0;
+  for (int i = 0; i < 16; i++)
+    bits |= (uint32_t)indices[i] << (i * 2);
+
+  writeLE16(out, color0);
+  writeLE16(out + 2, color1);
+  out[4] = (unsigned char)bits;
+  out[5] = (unsigned char)(bits >> 8);
+  out[6] = (unsigned char)(bits >> 16);
+  out[7] = (unsigned char)(bits >> 24);
+}
+
+static void decodeColorBlock(const unsigned char *in, unsigned char *rgba, bool alwaysFourColors) {
+  uint16_t color0 = (uint16_t)(in[0] | (in[1] << 8)), color1 = (uint16_t)(in[2] | (in[3] << 8));
+  uint32_t bits = (uint32_t)in[4] | ((uint32_t)in[5] << 8) | ((uint32_t)in[6] << 16) | ((uint32_t)in[7] << 24);
+
+  float c0[3], c1[3];
+  from565(color0, c0);
+  from565(color1, c1);
+
+  float palette[4][4];
+  for (int c = 0; c < 3; c++) {
+    palette[0][c] = c0[c];
+    palette[1][c] = c1[c];
+    if (color0 > color1 || alwaysFourColors) {
+      palette[2][c] = (2.0f * c0[c] + c1[c]) / 3.0f;
+      palette[3][c] = (c0[c] + 2.0f * c1[c]) / 3.0f;
+    } else {
+      palette[2][c] = (c0[c] + c1[c]) / 2.0f;
+      palette[3][c] = 0.0f;
+    }
+  }
+  for (int k = 0; k < 4; k++)
+    palette[k][3] = (k == 3 && color0 <= color1 && !alwaysFourColors) ? 0.0f : 255.0f;
+
+  for (int i = 0; i < 16; i++) {
+    int index = (bits >> (i * 2)) & 3;
+    for (int c = 0; c < 4; c++)
+      rgba[i * 4 + c] = (unsigned char)(palette[index][c] + 0.5f);
+  }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// BC3 alpha block: two 8 bit endpoints, eight interpolated values, 3 bit indices
+
+static void encodeAlphaBlock(const Block &block, unsigned char *out) {
+  float lo = 255.0f, hi = 0.0f;
+  for (int i = 0; i < 16; i++) {
+    lo = block.a[i] < lo ? block.a[i] : lo;
+    hi = block.a[i] > hi ? block.a[i] : hi;
+  }
+
+  int alpha0 = (int)(hi + 0.5f), alpha1 = (int)(lo + 0.5f);
+  float values[8];
+  values[0] = (float)alpha0;
+  values[1] = (float)alpha1;
+  for (int k = 1; k < 7; k++)
+    values[k + 1] = (float)(((7 - k) * alpha0 + k * alpha1) / 7);
+
+  uint64_t bits = 0;
+  for (int i = 0; i < 16; i++) {
+    int best = 0;
+    float bestDistance = FLT_MAX;
+    for (int k = 0; k < (alpha0 == alpha1 ? 1 : 8); k++) {
+      float distance = fabsf(block.a[i] - values[k]);
+      if (distance < bestDistance) {
+        bestDistance = distance;
+        best = k;
+      }
+    }
+    bits |= (uint64_t)best << (i * 3);
+  }
+
+  out[0] = (unsigned char)alpha0;
+  out[1] = (unsigned char)alpha1;
+  for (int i = 0; i < 6; i++)
+    out[2 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+static void decodeAlphaBlock(const unsigned char *in, unsigned char *rgba) {
+  int alpha0 = in[0], alpha1 = in[1];
+  uint64_t bits = 0;
+  for (int i = 0; i < 6; i++)
+    bits |= (uint64_t)in[2 + i] << (i * 8);
+
+  int values[8] = {alpha0, alpha1};
+  for (int k = 1; k < 7; k++) {
+    if (alpha0 > alpha1)
+      values[k + 1] = ((7 - k) * alpha0 + k * alpha1) / 7;
+    else
+      values[k + 1] = k < 5 ? ((5 - k) * alpha0 + k * alpha1) / 5 : (k == 5 ? 0 : 255);
+  }
+
+  for (int i = 0; i < 16; i++)
+    rgba[i * 4 + 3] = (unsigned char)values[(bits >> (i * 3)) & 7];
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+// BC7 mode 6: RGBA endpoints of 7 bits plus a shared low bit (p-bit) per endpoint, 16 interpolation steps
+
+static const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+struct BitWriter {
+  unsigned char *out;
+  int position;
+
+  void write(uint32_t value, int count) {
+    for (int i = 0; i < count; i++, position++) {
+      if ((value >> i) & 1)
+        out[position >> 3] |= (unsigned char)(1 << (position & 7));
+    }
+  }
+};
+
+struct BitReader {
+  const unsigned char *in;
+  int position;
+
+  uint32_t read(int count) {
+    uint32_t value = 0;
+    for (int i = 0; i < count; i++, position++)
+      value |= (uint32_t)((in[position >> 3] >> (position & 7)) & 1) << i;
+    return value;
+  }
+};
+
+// 7 bit values plus the p-bit that rounds the endpoint best, over all 4 channels
+static void quantizeEndpoint(const float *color, int *quantized, int &pbit) {
+  float bestError = FLT_MAX;
+  for (int p = 0; p < 2; p++) {
+    int values[4];
+    float error = 0.0f;
+    for (int c = 0; c < 4; c++) {
+      int v = (int)((color[c] - p) / 2.0f + 0.5f);
+      v = v < 0 ? 0 : (v > 127 ? 127 : v);
+      values[c] = v;
+      float difference = (float)(v * 2 + p) - color[c];
+      error += difference * difference;
+    }
+    if (error < bestError) {
+      bestError = error;
+      pbit = p;
+      memcpy(quantized, values, sizeof(values));
+    }
+  }
+}
+
+static float fitMode6(const Block &block, const float *start, const float *end, int *q0, int &p0, int *q1, int &p1, unsigned char *indices) {
+  quantizeEndpoint(start, q0, p0);
+  quantizeEndpoint(end, q1, p1);
+
+  Palette palette;
+  palette.count = 16;
+  float *channels[4] = {palette.r, palette.g, palette.b, palette.a};
+  for (int c = 0; c < 4; c++) {
+    int e0 = q0[c] * 2 + p0, e1 = q1[c] * 2 + p1;
+    for (int k = 0; k < 16; k++)
+      channels[c][k] = (float)(((64 - BC7_WEIGHTS[k]) * e0 + BC7_WEIGHTS[k] * e1 + 32) >> 6);
+  }
+
+  return selectIndices(block, palette, true, indices);
+}
+
+static void encodeBC7Block(const Block &block, unsigned char *out) {
+  float start[4], end[4];
+  axisEndpoints(block, 4, start, end);
+
+  int q0[4], q1[4], p0, p1;
+  unsigned char indices[16];
+  float error = fitMode6(block, start, end, q0, p0, q1, p1, indices);
+
+  // weight of the start endpoint for every index
+  float weights[16];
+  for (int k = 0; k < 16; k++)
+    weights[k] = 1.0f - BC7_WEIGHTS[k] / 64.0f;
+
+  for (int iteration = 0; iteration < 2; iteration++) {
+    if (!refineEndpoints(block, indices, weights, start, end))
+      break;
+
+    int r0[4], r1[4], rp0, rp1;
+    unsigned char refinedIndices[16];
+    float refinedError = fitMode6(block, start, end, r0, rp0, r1, rp1, refinedIndices);
+    if (refinedError >= error)
+      break;
+
+    error = refinedError;
+    memcpy(q0, r0, sizeof(r0));
+    memcpy(q1, r1, sizeof(r1));
+    p0 = rp0;
+    p1 = rp1;
+    memcpy(indices, refinedIndices, 16);
+  }
+
+  // the first pixel's index is stored without its top bit, so it must be below 8: swap the endpoints if it is not
+  if (indices[0] >= 8) {
+    for (int c = 0; c < 4; c++) {
+      int swap = q0[c];
+      q0[c] = q1[c];
+      q1[c] = swap;
+    }
+    int swap = p0;
+    p0 = p1;
+    p1 = swap;
+    for (int i = 0; i < 16; i++)
+      indices[i] = (unsigned char)(15 - indices[i]);
+  }
+
+  memset(out, 0, 16);
+  BitWriter writer = {out, 0};
+  writer.write(1 << 6, 7); // mode 6
+  for (int c = 0; c < 4; c++) {
+    writer.write(q0[c], 7);
+    writer.write(q1[c], 7);
+  }
+  writer.write(p0, 1);
+  writer.write(p1, 1);
+  for (int i = 0; i < 16; i++)
+    writer.write(indices[i], i == 0 ? 3 : 4);
+}
+
+static void decodeBC7Block(const unsigned char *in, unsigned char *rgba) {
+  BitReader reader = {in, 0};
+  if (reader.read(7) != (1 << 6)) {
+    // only mode 6 is ever written here, anything else decodes to transparent black like an invalid block would
+    memset(rgba, 0, 64);
+    return;
+  }
+
+  int e0[4], e1[4];
+  for (int c = 0; c < 4; c++) {
+    e0[c] = reader.read(7) << 1;
+    e1[c] = reader.read(7) << 1;
+  }
+  int p0 = reader.read(1), p1 = reader.read(1);
+  for (int c = 0; c < 4; c++) {
+    e0[c] |= p0;
+    e1[c] |= p1;
+  }
+
+  for (int i = 0; i < 16; i++) {
+    int weight = BC7_WEIGHTS[reader.read(i == 0 ? 3 : 4)];
+    for (int c = 0; c < 4; c++)
+      rgba[i * 4 + c] = (unsigned char)(((64 - weight) * e0[c] + weight * e1[c] + 32) >> 6);
+  }
+}
+
+// ---------------------------------------------------------------------------------------------------------------------
+
+// gathers a 4x4 block, repeating the last row/column for blocks hanging over the edge
+static void loadBlock(const unsigned char *pixels, int width, int height, int channels, int blockX, int blockY, Block &block) {
+  for (int y = 0; y < 4; y++) {
+    int sy = blockY * 4 + y < height ? blockY * 4 + y : height - 1;
+    for (int x = 0; x < 4; x++) {
+      int sx = blockX * 4 + x < width ? blockX * 4 + x : width - 1;
+      const unsigned char *pixel = pixels + ((size_t)sy * width + sx) * channels;
+      block.r[y * 4 + x] = pixel[0];
+      block.g[y * 4 + x] = pixel[1];
+      block.b[y * 4 + x] = pixel[2];
+      block.a[y * 4 + x] = channels == 4 ? pixel[3] : 255.0f;
+    }
+  }
+}
+
+static void encodeBlock(BlockFormat format, const Block &block, unsigned char *out) {
+  switch (format) {
+  case BLOCK_BC1:
+    encodeColorBlock(block, out);
+    break;
+  case BLOCK_BC3:
+    encodeAlphaBlock(block, out);
+    encodeColorBlock(block, out + 8);
+    break;
+  case BLOCK_BC7:
+    encodeBC7Block(block, out);
+    break;
+  }
+}
+
+void compressImage(BlockFormat format, const unsigned char *pixels, int width, int height, int channels, unsigned char *out, unsigned int threads) {
+  int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  size_t bytes = blockBytes(format);
+
+  if (threads == 0)
+    threads = std::thread::hardware_concurrency();
+  if (threads == 0)
+    threads = 1;
+  if (threads > (unsigned int)blocksY)
+    threads = blocksY;
+
+  // block rows are handed out one at a time, so threads that get easy rows simply take more of them
+  std::atomic<int> nextRow(0);
+  std::vector<std::thread> workers;
+
+  struct Worker {
+    static void run(BlockFormat format, const unsigned char *pixels, int width, int height, int channels, unsigned char *out, int blocksX, int blocksY,
+                    size_t bytes, std::atomic<int> *nextRow) {
+      Block block;
+      for (int row = nextRow->fetch_add(1); row < blocksY; row = nextRow->fetch_add(1)) {
+        for (int column = 0; column < blocksX; column++) {
+          loadBlock(pixels, width, height, channels, column, row, block);
+          encodeBlock(format, block, out + ((size_t)row * blocksX + column) * bytes);
+        }
+      }
+    }
+  };
+
+  for (unsigned int i = 1; i < threads; i++)
+    workers.push_back(std::thread(Worker::run, format, pixels, width, height, channels, out, blocksX, blocksY, bytes, &nextRow));
+  Worker::run(format, pixels, width, height, channels, out, blocksX, blocksY, bytes, &nextRow);
+
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+}
+
+void decompressImage(BlockFormat format, const unsigned char *blocks, int width, int height, unsigned char *rgba) {
+  int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+  size_t bytes = blockBytes(format);
+  unsigned char decoded[64];
+
+  for (int by = 0; by < blocksY; by++) {
+    for (int bx = 0; bx < blocksX; bx++) {
+      const unsigned char *block = blocks + ((size_t)by * blocksX + bx) * bytes;
+      switch (format) {
+      case BLOCK_BC1:
+        decodeColorBlock(block, decoded, false);
+        break;
+      case BLOCK_BC3:
+        decodeColorBlock(block + 8, decoded, true);
+        decodeAlphaBlock(block, decoded);
+        break;
+      case BLOCK_BC7:
+        decodeBC7Block(block, decoded);
+        break;
+      }
+
+      for (int y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+          memcpy(rgba + ((size_t)(by * 4 + y) * width + bx * 4 + x) * 4, decoded + (y * 4 + x) * 4, 4);
+      }
+    }
+  }
+}
+
+double computePSNR(const unsigned char *pixels, int channels, const unsigned char *rgba, int width, int height) {
+  double squaredError = 0.0;
+  size_t count = (size_t)width * height;
+
+  for (size_t i = 0; i < count; i++) {
+    for (int c = 0; c < channels; c++) {
+      double difference = (double)pixels[i * channels + c] - (double)rgba[i * 4 + c];
+      squaredError += difference * difference;
+    }
+  }
+
+  double mse = squaredError / (double)(count * channels);
+  if (mse == 0.0)
+    return INFINITY;
+  return 10.0 * log10(255.0 * 255.0 / mse);
+}
@@ -0,0 +1,45 @@
+#ifndef BLOCK_COMPRESSOR_H
+#define BLOCK_COMPRESSOR_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+
+// not part of GL 3.3 core, the formats come from EXT_texture_compression_s3tc and ARB_texture_compression_bptc
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#endif
+#ifndef GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#endif
+
+enum BlockFormat {
+  BLOCK_BC1, // 4 bpp, RGB
+  BLOCK_BC3, // 8 bpp, RGB + separately coded alpha
+  BLOCK_BC7  // 8 bpp, RGBA, encoded with mode 6 only (one subset, 7.1 bit endpoints, 4 bit indices)
+};
+
+const char *blockFormatName(BlockFormat format);
+GLenum blockInternalFormat(BlockFormat format);
+size_t blockBytes(BlockFormat format);
+
+// size of a compressed image, partial blocks at the edges included
+size_t compressedSize(BlockFormat format, int width, int height);
+
+/*
+ Compresses RGB8 or RGBA8 pixels (channels 3 or 4, rows tightly packed) into 4x4 blocks, spreading block rows
+ over `threads` threads (0 means one per hardware thread). Index selection, the inner loop, uses AVX2 or SSE4.1
+ when the compiler targets them and plain C++ otherwise.
+*/
+void compressImage(BlockFormat format, const unsigned char *pixels, int width, int height, int channels, unsigned char *out, unsigned int threads = 0);
+
+// decodes back to RGBA8, to measure what the GPU will sample
+void decompressImage(BlockFormat format, const unsigned char *blocks, int width, int height, unsigned char *rgba);
+
+// peak signal to noise ratio in dB between the source and an RGBA8 image, over RGB (and alpha when channels is 4)
+double computePSNR(const unsigned char *pixels, int channels, const unsigned char *rgba, int width, int height);
+
+#endif
@@ -0,0 +1,347 @@
+#include <cfloat>
+#include <cmath>
+
+#include <cstring>
+
+#include "bvh.h"
+#include "job_system.h"
+
+// centroid bins per axis the surface area heuristic evaluates splits between
+static const int SAH_BINS = 16;
+static const uint32_t ALL_PLANES = (1 << 6) - 1;
+
+// below this many objects the threaded cull is not worth the jobs
+static const size_t PARALLEL_CULL_OBJECTS = 16384;
+
+// half the surface area, the factor 2 cancels out of every comparison
+static float halfArea(const glm::vec3 &boundsMin, const glm::vec3 &boundsMax) {
+  glm::vec3 size = boundsMax - boundsMin;
+  return size.x * size.y + size.y * size.z + size.z * size.x;
+}
+
+enum PlaneSide { OUTSIDE, CROSSING, INSIDE };
+
+// the same distance test as CullingVolumes::cullScalar, plus whether the whole box is in front of the plane
+static PlaneSide planeSide(const glm::vec4 &plane, const glm::vec3 &center, const glm::vec3 &extents) {
+  float distance = plane.x * center.x + plane.y * center.y + plane.z * center.z + plane.w;
+  float radius = fabsf(plane.x) * extents.x + fabsf(plane.y) * extents.y + fabsf(plane.z) * extents.z;
+  if (distance + radius < 0.0f)
+    return OUTSIDE;
+  return distance - radius >= 0.0f ? INSIDE : CROSSING;
+}
+
+void BVH::build(const CullingVolumes *volumes) {
+  this->volumes = volumes;
+  uint32_t count = (uint32_t)volumes->size();
+
+  nodes.clear();
+  parents.clear();
+  firstObject.clear();
+  objects.resize(count);
+  objectLeaf.assign(count, 0);
+
+  entries.resize(count);
+  for (uint32_t i = 0; i < count; i++) {
+    glm::vec3 center = volumes->center(i), extents = volumes->extents(i);
+    entries[i].boundsMin = center - extents;
+    entries[i].boundsMax = center + extents;
+    entries[i].center = center;
+    entries[i].object = i;
+  }
+
+  if (count > 0) {
+    // a binary tree with at least one object per leaf never has more nodes than this, so the vector never moves while building
+    nodes.reserve(2 * count - 1);
+    parents.reserve(2 * count - 1);
+    firstObject.reserve(2 * count - 1);
+    nodes.push_back(BVHNode());
+    parents.push_back(0);
+    firstObject.push_back(0);
+    buildNode(0, 0, count, 0);
+  }
+  std::vector<BuildEntry>().swap(entries);
+  rejectPlane.assign(nodes.size(), 0);
+}
+
+void BVH::buildNode(uint32_t node, uint32_t first, uint32_t count, unsigned int depth) {
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX), centerMin(FLT_MAX), centerMax(-FLT_MAX);
+  for (uint32_t i = first; i < first + count; i++) {
+    boundsMin = glm::min(boundsMin, entries[i].boundsMin);
+    boundsMax = glm::max(boundsMax, entries[i].boundsMax);
+    centerMin = glm::min(centerMin, entries[i].center);
+    centerMax = glm::max(centerMax, entries[i].center);
+  }
+  nodes[node].boundsMin = boundsMin;
+  nodes[node].boundsMax = boundsMax;
+
+  if (count <= MAX_LEAF_SIZE || depth >= MAX_DEPTH) {
+    nodes[node].index = first;
+    nodes[node].count = count;
+    for (uint32_t i = first; i < first + count; i++) {
+      objects[i] = entries[i].object;
+      objectLeaf[entries[i].object] = node;
+    }
+    return;
+  }
+
+  // bin the object centers along each axis and sweep the bin boundaries for the cheapest split: the cost of a side is
+  // its object count weighted by the chance a query that reaches this node also reaches the side, its area ratio
+  float bestCost = FLT_MAX;
+  int bestAxis = -1, bestSplit = 0;
+  for (int axis = 0; axis < 3; axis++) {
+    float extent = centerMax[axis] - centerMin[axis];
+    if (extent <= 0.0f)
+      continue;
+    float scale = SAH_BINS / extent;
+
+    glm::vec3 binMin[SAH_BINS], binMax[SAH_BINS];
+    uint32_t binCount[SAH_BINS] = {0};
+    for (int b = 0; b < SAH_BINS; b++) {
+      binMin[b] = glm::vec3(FLT_MAX);
+      binMax[b] = glm::vec3(-FLT_MAX);
+    }
+    for (uint32_t i = first; i < first + count; i++) {
+      const BuildEntry &entry = entries[i];
+      int b = std::min((int)((entry.center[axis] - centerMin[axis]) * scale), SAH_BINS - 1);
+      // component by component: whole vector stores right before loads of the same bin stall the store forwarding
+      for (int c = 0; c < 3; c++) {
+        binMin[b][c] = std::min(binMin[b][c], entry.boundsMin[c]);
+        binMax[b][c] = std::max(binMax[b][c], entry.boundsMax[c]);
+      }
+      binCount[b]++;
+    }
+
+    // left to right sweep stores the left side of every split, right to left completes the cost
+    float leftArea[SAH_BINS - 1];
+    uint32_t leftCount[SAH_BINS - 1];
+    glm::vec3 sweepMin(FLT_MAX), sweepMax(-FLT_MAX);
+    uint32_t sweepCount = 0;
+    for (int b = 0; b < SAH_BINS - 1; b++) {
+      sweepMin = glm::min(sweepMin, binMin[b]);
+      sweepMax = glm::max(sweepMax, binMax[b]);
+      sweepCount += binCount[b];
+      leftArea[b] = sweepCount > 0 ? halfArea(sweepMin, sweepMax) : 0.0f;
+      leftCount[b] = sweepCount;
+    }
+
+    sweepMin = glm::vec3(FLT_MAX);
+    sweepMax = glm::vec3(-FLT_MAX);
+    sweepCount = 0;
+    for (int b = SAH_BINS - 1; b > 0; b--) {
+      sweepMin = glm::min(sweepMin, binMin[b]);
+      sweepMax = glm::max(sweepMax, binMax[b]);
+      sweepCount += binCount[b];
+      if (sweepCount == 0 || leftCount[b - 1] == 0)
+        continue;
+      float cost = leftArea[b - 1] * leftCount[b - 1] + halfArea(sweepMin, sweepMax) * sweepCount;
+      if (cost < bestCost) {
+        bestCost = cost;
+        bestAxis = axis;
+        bestSplit = b;
+      }
+    }
+  }
+
+  // with all centers in one point no split is better than another, halving at least keeps the tree balanced
+  uint32_t middle = first + count / 2;
+  if (bestAxis >= 0) {
+    float scale = SAH_BINS / (centerMax[bestAxis] - centerMin[bestAxis]);
+    BuildEntry *split = std::partition(&entries[first], &entries[first] + count, [&](const BuildEntry &entry) {
+      return std::min((int)((entry.center[bestAxis] - centerMin[bestAxis]) * scale), SAH_BINS - 1) < bestSplit;
+    });
+    middle = (uint32_t)(split - &entries[0]);
+  }
+
+  uint32_t left = (uint32_t)nodes.size();
+  nodes.push_back(BVHNode());
+  parents.push_back(node);
+  firstObject.push_back(first);
+  buildNode(left, first, middle - first, depth + 1);
+
+  uint32_t right = (uint32_t)nodes.size();
+  nodes.push_back(BVHNode());
+  parents.push_back(node);
+  firstObject.push_back(middle);
+  buildNode(right, middle, first + count - middle, depth + 1);
+
+  nodes[node].index = right;
+  nodes[node].count = 0;
+}
+
+void BVH::fitLeaf(uint32_t node) {
+  BVHNode &leaf = nodes[node];
+  glm::vec3 boundsMin(FLT_MAX), boundsMax(-FLT_MAX);
+  for (uint32_t i = leaf.index; i < leaf.index + leaf.count; i++) {
+    glm::vec3 center = volumes->center(objects[i]), extents = volumes->extents(objects[i]);
+    boundsMin = glm::min(boundsMin, center - extents);
+    boundsMax = glm::max(boundsMax, center + extents);
+  }
+  leaf.boundsMin = boundsMin;
+  leaf.boundsMax = boundsMax;
+}
+
+void BVH::fitInternal(uint32_t node) {
+  const BVHNode &left = nodes[node + 1], &right = nodes[nodes[node].index];
+  nodes[node].boundsMin = glm::min(left.boundsMin, right.boundsMin);
+  nodes[node].boundsMax = glm::max(left.boundsMax, right.boundsMax);
+}
+
+void BVH::refit() {
+  // children come after their parents, so walking backwards fits every child before its parent
+  for (size_t i = nodes.size(); i-- > 0;) {
+    if (nodes[i].count > 0)
+      fitLeaf((uint32_t)i);
+    else
+      fitInternal((uint32_t)i);
+  }
+}
+
+void BVH::refit(const uint32_t *changed, size_t count) {
+  for (size_t i = 0; i < count; i++) {
+    uint32_t node = objectLeaf[changed[i]];
+    glm::vec3 boundsMin = nodes[node].boundsMin, boundsMax = nodes[node].boundsMax;
+    fitLeaf(node);
+
+    // the ancestors only change while their child did
+    while (node != 0 && (nodes[node].boundsMin != boundsMin || nodes[node].boundsMax != boundsMax)) {
+      node = parents[node];
+      boundsMin = nodes[node].boundsMin;
+      boundsMax = nodes[node].boundsMax;
+      fitInternal(node);
+    }
+  }
+}
+
+float BVH::sahCost() const {
+  if (nodes.empty())
+    return 0.0f;
+
+  float rootArea = halfArea(nodes[0].boundsMin, nodes[0].boundsMax);
+  if (rootArea <= 0.0f)
+    return (float)objects.size();
+
+  // one unit per node visited and per object tested, each weighted by the chance a query reaches it
+  float cost = 0.0f;
+  for (size_t i = 0; i < nodes.size(); i++) {
+    float area = halfArea(nodes[i].boundsMin, nodes[i].boundsMax);
+    cost += area * (nodes[i].count > 0 ? nodes[i].count : 1);
+  }
+  return cost / rootArea;
+}
+
+bool BVH::visitNode(const Frustum &frustum, uint32_t index, uint32_t &mask) {
+  if (mask == 0)
+    return true;
+
+  const BVHNode &node = nodes[index];
+  glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f, extents = (node.boundsMax - node.boundsMin) * 0.5f;
+  uint8_t &lastPlane = rejectPlane[index];
+  if ((mask >> lastPlane) & 1) {
+    PlaneSide side = planeSide(frustum.planes[lastPlane], center, extents);
+    if (side == OUTSIDE)
+      return false;
+    if (side == INSIDE)
+      mask &= ~(1u << lastPlane);
+  }
+
+  for (int p = 0; p < 6; p++) {
+    if (!((mask >> p) & 1) || p == lastPlane)
+      continue;
+    PlaneSide side = planeSide(frustum.planes[p], center, extents);
+    if (side == OUTSIDE) {
+      lastPlane = (uint8_t)p;
+      return false;
+    }
+    if (side == INSIDE)
+      mask &= ~(1u << p);
+  }
+  return true;
+}
+
+size_t BVH::cullSubtree(const Frustum &frustum, uint32_t root, uint32_t mask, uint32_t *visible) {
+  CullEntry stack[64];
+  int top = 0;
+  stack[top].node = root;
+  stack[top++].mask = mask;
+
+  size_t count = 0;
+  while (top > 0) {
+    CullEntry entry = stack[--top];
+    if (!visitNode(frustum, entry.node, entry.mask))
+      continue;
+
+    const BVHNode &node = nodes[entry.node];
+    if (node.count > 0) {
+      for (uint32_t i = node.index; i < node.index + node.count; i++) {
+        uint32_t object = objects[i];
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+          if ((entry.mask >> p) & 1)
+            inside = planeSide(frustum.planes[p], volumes->center(object), volumes->extents(object)) != OUTSIDE;
+        }
+        visible[count] = object;
+        count += inside;
+      }
+      continue;
+    }
+
+    // left child on top, the nodes are then visited in memory order
+    stack[top].node = node.index;
+    stack[top++].mask = entry.mask;
+    stack[top].node = entry.node + 1;
+    stack[top++].mask = entry.mask;
+  }
+  return count;
+}
+
+size_t BVH::cull(const Frustum &frustum, uint32_t *visible) { return nodes.empty() ? 0 : cullSubtree(frustum, 0, ALL_PLANES, visible); }
+
+size_t BVH::cull(const Frustum &frustum, uint32_t *visible, JobSystem &jobs) {
+  if (objects.size() < PARALLEL_CULL_OBJECTS || jobs.threadCount() < 2)
+    return cull(frustum, visible);
+
+  // cull the top of the tree breadth first until there are enough subtrees left to keep every thread busy
+  size_t target = jobs.threadCount() * 8;
+  cullLevel.assign(1, CullEntry());
+  cullLevel[0].node = 0;
+  cullLevel[0].mask = ALL_PLANES;
+  while (cullLevel.size() < target) {
+    bool split = false;
+    cullNext.clear();
+    for (size_t i = 0; i < cullLevel.size(); i++) {
+      CullEntry entry = cullLevel[i];
+      if (nodes[entry.node].count > 0) {
+        cullNext.push_back(entry);
+        continue;
+      }
+      if (!visitNode(frustum, entry.node, entry.mask))
+        continue;
+      CullEntry left = {entry.node + 1, entry.mask}, right = {nodes[entry.node].index, entry.mask};
+      cullNext.push_back(left);
+      cullNext.push_back(right);
+      split = true;
+    }
+    cullLevel.swap(cullNext);
+    if (!split)
+      break;
+  }
+
+  // a subtree's objects are contiguous in objects, so each one writes to its own slice of visible
+  cullCounts.resize(cullLevel.size());
+  jobs.parallelFor((uint32_t)cullLevel.size(), 1, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t i = begin; i < end; i++)
+      cullCounts[i] = cullSubtree(frustum, cullLevel[i].node, cullLevel[i].mask, visible + firstObject[cullLevel[i].node]);
+  });
+
+  // left to right the slices only ever move down
+  size_t count = 0;
+  for (size_t i = 0; i < cullLevel.size(); i++) {
+    memmove(visible + count, visible + firstObject[cullLevel[i].node], cullCounts[i] * sizeof(uint32_t));
+    count += cullCounts[i];
+  }
+  return count;
+}
+
+bool BVH::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) const {
+  return raycast(origin, direction, maxDistance, hit, [](uint32_t, float &) { return true; });
+}
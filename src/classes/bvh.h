@@ -0,0 +1,182 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "frustum_culling.h"
+
+class JobSystem;
+
+// one node of the flattened tree, two per cache line. Nodes are stored depth first, so a node's left child is the next
+// node and every child comes after its parent
+struct BVHNode {
+  glm::vec3 boundsMin;
+  uint32_t index; // leaf: first entry of its objects in BVH::objects, internal node: its right child
+  glm::vec3 boundsMax;
+  uint32_t count; // objects in a leaf, 0 for internal nodes
+};
+
+static_assert(sizeof(BVHNode) == 32, "BVHNode should stay 32 bytes");
+
+struct RayHit {
+  uint32_t object;
+  float distance; // along the ray direction, in units of its length
+};
+
+// slab test of a ray against a box, direction given as its reciprocal. On a hit distance is where the ray enters the box, or 0 when it starts inside
+inline bool intersectRayBox(const glm::vec3 &origin, const glm::vec3 &inverseDirection, const glm::vec3 &boxMin, const glm::vec3 &boxMax, float maxDistance,
+                            float &distance) {
+  glm::vec3 t0 = (boxMin - origin) * inverseDirection;
+  glm::vec3 t1 = (boxMax - origin) * inverseDirection;
+  glm::vec3 entries = glm::min(t0, t1), exits = glm::max(t0, t1);
+  float enter = std::max(std::max(entries.x, entries.y), std::max(entries.z, 0.0f));
+  float exit = std::min(std::min(exits.x, exits.y), std::min(exits.z, maxDistance));
+  distance = enter;
+  return enter <= exit;
+}
+
+/*
+ Bounding volume hierarchy over the boxes of a CullingVolumes, for culling and picking in O(log n) instead of testing
+ every object. build() splits with the surface area heuristic over binned centroids; when objects move, update their
+ boxes in the volumes and refit() the existing tree instead of building a new one. Refitting keeps the topology, so
+ the tree gets looser as objects travel far from where they were at build time, sahCost() tells when a rebuild pays.
+*/
+class BVH {
+public:
+  static const unsigned int MAX_LEAF_SIZE = 4;
+  static const unsigned int MAX_DEPTH = 60; // the traversal stacks hold 64 entries
+
+  std::vector<BVHNode> nodes;
+  std::vector<uint32_t> objects; // object indices, grouped by leaf
+
+  BVH() : volumes(NULL) {}
+
+  // the volumes must outlive the tree, refit and the queries read the object boxes from them
+  void build(const CullingVolumes *volumes);
+
+  // recomputes every node's bounds from the current object boxes
+  void refit();
+
+  // only the leaves holding the changed objects and their ancestors, stopping where a parent's bounds stay the same
+  void refit(const uint32_t *changed, size_t count);
+
+  // expected cost of a random query relative to testing the root alone, grows as refits loosen the tree
+  float sahCost() const;
+
+  /*
+   Writes the indices of the objects that intersect the frustum to visible (room for volumes->size() entries) and
+   returns how many there are. A node entirely inside a plane clears that plane from the mask its children are tested
+   with, so subtrees well inside the frustum are not tested at all. Each node also remembers the plane that rejected it
+   last time and tries that one first, which is almost always right again while the camera moves smoothly.
+  */
+  size_t cull(const Frustum &frustum, uint32_t *visible);
+
+  // the same result, with the top of the tree culled here and the subtrees below it on all threads of jobs
+  size_t cull(const Frustum &frustum, uint32_t *visible, JobSystem &jobs);
+
+  // nearest object whose box the ray hits within maxDistance
+  bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit) const;
+
+  /*
+   The same traversal with an exact test for the object itself: test(object, distance) gets the distance at which the
+   ray enters the object's box and returns whether the ray hits the object, updating distance to the real hit.
+  */
+  template <typename Test> bool raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit, Test test) const;
+
+private:
+  // an object's box copied next to its center while building, so the binning passes read memory in order
+  struct BuildEntry {
+    glm::vec3 boundsMin, boundsMax, center;
+    uint32_t object;
+  };
+
+  const CullingVolumes *volumes;
+  std::vector<BuildEntry> entries;   // only during build()
+  std::vector<uint32_t> parents;     // per node, the root is its own parent
+  std::vector<uint32_t> objectLeaf;  // per object, the leaf that holds it
+  std::vector<uint8_t> rejectPlane;  // per node, the plane that culled it last
+  std::vector<uint32_t> firstObject; // per node, where the objects of its subtree start in objects
+
+  struct CullEntry {
+    uint32_t node;
+    uint32_t mask; // planes the node can still be outside of
+  };
+  std::vector<CullEntry> cullLevel, cullNext; // the threaded cull's subtrees, reused between calls
+  std::vector<size_t> cullCounts;
+
+  void buildNode(uint32_t node, uint32_t first, uint32_t count, unsigned int depth);
+  void fitLeaf(uint32_t node);
+  void fitInternal(uint32_t node);
+  bool visitNode(const Frustum &frustum, uint32_t node, uint32_t &mask);
+  size_t cullSubtree(const Frustum &frustum, uint32_t root, uint32_t mask, uint32_t *visible);
+};
+
+template <typename Test> bool BVH::raycast(const glm::vec3 &origin, const glm::vec3 &direction, float maxDistance, RayHit &hit, Test test) const {
+  if (nodes.empty())
+    return false;
+
+  glm::vec3 inverseDirection = glm::vec3(1.0f) / direction;
+  float best = maxDistance;
+  bool found = false;
+
+  struct Entry {
+    uint32_t node;
+    float distance;
+  };
+  Entry stack[64];
+  int top = 0;
+  float rootDistance;
+  if (!intersectRayBox(origin, inverseDirection, nodes[0].boundsMin, nodes[0].boundsMax, best, rootDistance))
+    return false;
+  stack[top].node = 0;
+  stack[top++].distance = rootDistance;
+
+  while (top > 0) {
+    Entry entry = stack[--top];
+    // something nearer was found after this node was pushed
+    if (entry.distance > best)
+      continue;
+
+    const BVHNode &node = nodes[entry.node];
+    if (node.count > 0) {
+      for (uint32_t i = node.index; i < node.index + node.count; i++) {
+        uint32_t object = objects[i];
+        glm::vec3 center = volumes->center(object), extents = volumes->extents(object);
+        float distance;
+        if (intersectRayBox(origin, inverseDirection, center - extents, center + extents, best, distance) && test(object, distance) && distance <= best) {
+          best = distance;
+          hit.object = object;
+          hit.distance = distance;
+          found = true;
+        }
+      }
+      continue;
+    }
+
+    // nearer child on top of the stack, so it is searched first and shrinks best for the other one
+    uint32_t left = entry.node + 1, right = node.index;
+    float leftDistance, rightDistance;
+    bool hitLeft = intersectRayBox(origin, inverseDirection, nodes[left].boundsMin, nodes[left].boundsMax, best, leftDistance);
+    bool hitRight = intersectRayBox(origin, inverseDirection, nodes[right].boundsMin, nodes[right].boundsMax, best, rightDistance);
+    if (hitLeft && hitRight && leftDistance > rightDistance) {
+      std::swap(left, right);
+      std::swap(leftDistance, rightDistance);
+      std::swap(hitLeft, hitRight);
+    }
+    if (hitRight) {
+      stack[top].node = right;
+      stack[top++].distance = rightDistance;
+    }
+    if (hitLeft) {
+      stack[top].node = left;
+      stack[top++].distance = leftDistance;
+    }
+  }
+  return found;
+}
+
+#endif
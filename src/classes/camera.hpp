@@ -14,8 +14,12 @@ const float PITCH = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ASPECT = 800.0f / 600.0f;
+const float NEAR_PLANE = 0.1f;
+const float FAR_PLANE = 100.0f;
 
-// An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
+// An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL.
+// The matrices are cached and only rebuilt after something changed. Code writing the attributes directly must call Invalidate()
 class Camera {
 public:
   // camera Attributes
@@ -30,11 +34,16 @@ public:
   // camera options
   float MovementSpeed;
   float MouseSensitivity;
-  float Zoom;
+  float Zoom; // vertical field of view in degrees
+  // projection
+  float Aspect;
+  float Near;
+  float Far;
 
   // constructor with vectors
   Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH)
-      : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM) {
+      : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM), Aspect(ASPECT), Near(NEAR_PLANE), Far(FAR_PLANE),
+        dirty(VIEW_DIRTY | PROJECTION_DIRTY), version(nextVersion()) {
     Position = position;
     WorldUp = up;
     Yaw = yaw;
@@ -43,11 +52,68 @@ public:
   }
 
   // returns the view matrix calculated using Euler Angles and the LookAt Matrix
-  glm::mat4 GetViewMatrix() { return glm::lookAt(Position, Position + Front, Up); }
+  const glm::mat4 &GetViewMatrix() {
+    update();
+    return view;
+  }
+
+  const glm::mat4 &GetProjectionMatrix() {
+    update();
+    return projection;
+  }
+
+  // projection * view, what the vertex shader needs
+  const glm::mat4 &GetViewProjectionMatrix() {
+    update();
+    return viewProjection;
+  }
+
+  // from clip space back to world space, for unprojecting the mouse or the frustum corners
+  const glm::mat4 &GetInverseViewProjectionMatrix() {
+    update();
+    return inverseViewProjection;
+  }
+
+  // world space ray through a point given in normalized device coordinates, (0, 0) is the center of the screen. For picking
+  void GetRay(float ndcX, float ndcY, glm::vec3 &origin, glm::vec3 &direction) {
+    const glm::mat4 &inverse = GetInverseViewProjectionMatrix();
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+  }
+
+  // changes every time the camera moves or its projection changes. Anything derived from the camera (culling results,
+  // uploaded uniforms) can remember the version it was built for and skip the work while it still matches. Versions
+  // come from one counter shared by all cameras, so switching to another camera never matches
+  unsigned int GetVersion() const { return version; }
+
+  void SetPerspective(float aspect, float nearPlane, float farPlane) {
+    Aspect = aspect;
+    Near = nearPlane;
+    Far = farPlane;
+    markDirty(PROJECTION_DIRTY);
+  }
+
+  void SetAspect(float aspect) {
+    if (aspect != Aspect) {
+      Aspect = aspect;
+      markDirty(PROJECTION_DIRTY);
+    }
+  }
+
+  // after writing Position, Yaw, Pitch, Zoom or the projection attributes directly
+  void Invalidate() {
+    updateCameraVectors();
+    markDirty(VIEW_DIRTY | PROJECTION_DIRTY);
+  }
 
   // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
   void ProcessKeyboard(Camera_Movement direction, float deltaTime) {
     float velocity = MovementSpeed * deltaTime;
+    if (velocity == 0.0f)
+      return;
+    markDirty(VIEW_DIRTY);
     if (direction == FORWARD)
       Position += Front * velocity;
     if (direction == BACKWARD)
@@ -60,6 +126,9 @@ public:
 
   // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
   void ProcessMouseMovement(float xoffset, float yoffset, GLboolean constrainPitch = true) {
+    if (xoffset == 0.0f && yoffset == 0.0f)
+      return;
+
     xoffset *= MouseSensitivity;
     yoffset *= MouseSensitivity;
 
@@ -76,18 +145,56 @@ public:
 
     // update Front, Right and Up Vectors using the updated Euler angles
     updateCameraVectors();
+    markDirty(VIEW_DIRTY);
   }
 
   // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
   void ProcessMouseScroll(float yoffset) {
+    float zoom = Zoom;
     Zoom -= (float)yoffset;
     if (Zoom < 1.0f)
       Zoom = 1.0f;
     if (Zoom > 45.0f)
       Zoom = 45.0f;
+    if (Zoom != zoom)
+      markDirty(PROJECTION_DIRTY);
   }
 
 private:
+  enum { VIEW_DIRTY = 1 << 0, PROJECTION_DIRTY = 1 << 1 };
+
+  // cached matrices, valid while dirty is 0
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  glm::mat4 inverseViewProjection;
+  unsigned int dirty;
+  unsigned int version;
+
+  void markDirty(unsigned int flags) {
+    dirty |= flags;
+    version = nextVersion();
+  }
+
+  // never 0, what holders of a version start from. Cameras live on the GL thread, the counter is not atomic
+  static unsigned int nextVersion() {
+    static unsigned int counter = 0;
+    return ++counter;
+  }
+
+  // rebuilds only what changed since the last call
+  void update() {
+    if (dirty == 0)
+      return;
+    if (dirty & VIEW_DIRTY)
+      view = glm::lookAt(Position, Position + Front, Up);
+    if (dirty & PROJECTION_DIRTY)
+      projection = glm::perspective(glm::radians(Zoom), Aspect, Near, Far);
+    viewProjection = projection * view;
+    inverseViewProjection = glm::inverse(viewProjection);
+    dirty = 0;
+  }
+
   // calculates the front vector from the Camera's (updated) Euler Angles
   void updateCameraVectors() {
     // calculate the new Front vector
@@ -0,0 +1,81 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "camera.hpp"
+
+struct CameraKey {
+  float time; // seconds from the start of the path
+  glm::vec3 position;
+  float yaw, pitch;
+};
+
+/*
+ A scripted flight through keyframes, for benchmarks and reference renders that have to see the same frames every run.
+ Positions follow a Catmull-Rom spline through the keys and the angles are eased between them, so the camera neither
+ stops nor jumps at a key. Times before the first or after the last key hold the nearest key.
+*/
+class CameraPath {
+public:
+  std::vector<CameraKey> keys; // in increasing time
+
+  void add(float time, const glm::vec3 &position, float yaw, float pitch) {
+    CameraKey key = {time, position, yaw, pitch};
+    keys.push_back(key);
+  }
+
+  float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+  // moves the camera to where the path is at time
+  void apply(Camera &camera, float time) const {
+    if (keys.empty())
+      return;
+
+    size_t next = 0;
+    while (next < keys.size() && keys[next].time <= time)
+      next++;
+    if (next == 0 || next == keys.size()) {
+      const CameraKey &key = keys[next == 0 ? 0 : keys.size() - 1];
+      set(camera, key.position, key.yaw, key.pitch);
+      return;
+    }
+
+    const CameraKey &a = keys[next - 1], &b = keys[next];
+    const CameraKey &before = keys[next >= 2 ? next - 2 : next - 1], &after = keys[next + 1 < keys.size() ? next + 1 : next];
+    float t = (time - a.time) / (b.time - a.time);
+
+    // uniform Catmull-Rom between a and b
+    float t2 = t * t, t3 = t2 * t;
+    glm::vec3 position = 0.5f * ((2.0f * a.position) + (b.position - before.position) * t + (2.0f * before.position - 5.0f * a.position + 4.0f * b.position - after.position) * t2 +
+                                 (3.0f * a.position - before.position - 3.0f * b.position + after.position) * t3);
+    float eased = t2 * (3.0f - 2.0f * t);
+    set(camera, position, a.yaw + (b.yaw - a.yaw) * eased, a.pitch + (b.pitch - a.pitch) * eased);
+  }
+
+  // the flight the benchmarks use: once around the cubes of CubeScene in 8 seconds, always facing into the group, with
+  // the yaw only ever decreasing so the easing never swings the long way round
+  static CameraPath cubeFlight() {
+    CameraPath path;
+    path.add(0.0f, glm::vec3(0.0f, 0.0f, 3.0f), -90.0f, 0.0f);
+    path.add(2.0f, glm::vec3(5.0f, 1.0f, -5.0f), -180.0f, -5.0f);
+    path.add(4.0f, glm::vec3(0.0f, 2.0f, -22.0f), -270.0f, -5.0f);
+    path.add(6.0f, glm::vec3(-8.0f, 0.0f, -7.0f), -360.0f, 5.0f);
+    path.add(8.0f, glm::vec3(0.0f, 0.0f, 3.0f), -450.0f, 0.0f);
+    return path;
+  }
+
+private:
+  static void set(Camera &camera, const glm::vec3 &position, float yaw, float pitch) {
+    if (camera.Position == position && camera.Yaw == yaw && camera.Pitch == pitch)
+      return;
+    camera.Position = position;
+    camera.Yaw = yaw;
+    camera.Pitch = pitch;
+    camera.Invalidate();
+  }
+};
+
+#endif
@@ -0,0 +1,148 @@
+#include <iostream>
+#include <thread>
+
+#include "cube_scene.h"
+#include "gl_state_cache.h"
+#include "profiler.h"
+#include "program_binary_cache.h"
+#include "shader.h"
+
+// every cube is turned around the same axis
+static const glm::vec3 CUBE_AXIS = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+
+unsigned int CubeScene::jobThreads() {
+  unsigned int hardware = std::thread::hardware_concurrency();
+  return hardware > 0 && hardware < MAX_JOB_THREADS ? hardware : MAX_JOB_THREADS;
+}
+
+CubeScene::CubeScene(const std::string &root, JobSystem &jobs)
+    : defaultPrograms(shaderLibrary, (root + "shaders/default/vertex.glsl").c_str(), (root + "shaders/default/fragment.glsl").c_str()), visibleCount(0),
+      changedCount(0), changedTotal(0), framesRendered(0), jobs(jobs), cube(NULL), culledCameraVersion(0) {
+  // every program is submitted before any of them is waited on, the driver compiles them while the textures start loading
+  Shader &defaultShader = *defaultPrograms.get(FEATURE_TEXTURE2_BLEND);
+  Shader &instancedShader = *defaultPrograms.get(FEATURE_INSTANCED | FEATURE_TEXTURE2_BLEND);
+
+  // textures load in the background from the texture cache, the cubes render with white placeholders until pump() uploads them
+  textureLoader.setUploadRing(&uploadRing);
+  woodTexture = textureLoader.load((root + "assets/container.png").c_str(), true, true);
+  awesomeTexture = textureLoader.load((root + "assets/awesome.png").c_str(), true, true);
+
+  cube = new CubeModel(&defaultShader, woodTexture.id(), awesomeTexture.id(), &instancedShader);
+
+  // draws are queued while the frame is built and issued sorted by state at the end of it
+  cube->addTo(renderQueue);
+
+  shaderLibrary.finishAll();
+  std::cout << "STATS::SHADER::STARTUP COMPILED " << ProgramBinaryCache::misses << " IN " << ProgramBinaryCache::missSeconds * 1000.0 << " ms CACHE_HIT "
+            << ProgramBinaryCache::hits << " IN " << ProgramBinaryCache::hitSeconds * 1000.0 << " ms" << std::endl;
+
+  // world space positions of our cubes, each one turned 20 degrees further around the same axis
+  glm::vec3 cubePositions[] = {glm::vec3(0.0f, 0.0f, 0.0f),   glm::vec3(2.0f, 5.0f, -15.0f), glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
+                               glm::vec3(2.4f, -0.4f, -3.5f), glm::vec3(-1.7f, 3.0f, -7.5f), glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
+                               glm::vec3(1.5f, 0.2f, -1.5f),  glm::vec3(-1.3f, 1.0f, -1.5f)};
+  for (unsigned int i = 0; i < CUBE_COUNT; i++)
+    transforms.create(cubePositions[i], glm::angleAxis(glm::radians(20.0f * i), CUBE_AXIS));
+  transforms.update();
+
+  // world space boxes around the unit cubes, refitted along with the transforms
+  for (unsigned int i = 0; i < CUBE_COUNT; i++)
+    cubeBounds.add(transforms.world[i], glm::vec3(0.5f));
+  cubeTree.build(&cubeBounds);
+}
+
+void CubeScene::finishLoading() {
+  shaderLibrary.finishAll();
+  while (!textureLoader.idle()) {
+    if (textureLoader.pump() == 0)
+      std::this_thread::yield();
+  }
+}
+
+void CubeScene::renderFrame(Camera &camera, float time, float deltaTime) {
+  ProfileScope frameScope("frame");
+  {
+    ProfileScope scope("textures");
+    textureLoader.pump();
+  }
+
+  // rendering
+  {
+    ProfileScope scope("clear");
+    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  }
+
+  // one upload for every program, and only the clocks while the camera stands still
+  {
+    ProfileScope scope("uniforms");
+    frameUniforms.update(camera, time, deltaTime);
+  }
+
+  // for (unsigned int i = 0; i < CUBE_COUNT; i += 3)
+  //   transforms.setRotation(i, glm::angleAxis(glm::radians(time * 25.0f), CUBE_AXIS));
+
+  // only the cubes whose transform changed get a new matrix, a new box and their path in the tree refitted
+  {
+    ProfileScope scope("transforms");
+    changedCount = transforms.update(changedCubes, &jobs);
+    changedTotal += changedCount;
+    framesRendered++;
+    for (size_t i = 0; i < changedCount; i++)
+      cubeBounds.set(changedCubes[i], transforms.world[changedCubes[i]], glm::vec3(0.5f));
+    if (changedCount > 0)
+      cubeTree.refit(changedCubes, changedCount);
+  }
+
+  // the visible set only changes with the camera or the cubes
+  if (camera.GetVersion() != culledCameraVersion || changedCount > 0) {
+    ProfileScope scope("cull");
+    visibleCount = cubeTree.cull(Frustum::fromMatrix(camera.GetViewProjectionMatrix()), visibleCubes, jobs);
+    culledCameraVersion = camera.GetVersion();
+  }
+
+  // all visible cubes in a single draw call
+  ProfileScope scope("cubes");
+  renderQueue.begin(camera.Far);
+  cube->submitInstanced(renderQueue, &transforms.world[0], visibleCubes, visibleCount, 0.0f, &jobs);
+  renderQueue.execute();
+}
+
+bool CubeScene::pick(Camera &camera, RayHit &hit) {
+  glm::vec3 origin, direction;
+  camera.GetRay(0.0f, 0.0f, origin, direction);
+  return cubeTree.raycast(origin, direction, camera.Far, hit, [&](uint32_t object, float &distance) {
+    // the box is loose around the rotated cube, so test the cube itself in its model space. The model matrix has no
+    // scale, distances there are the same as in world space
+    glm::mat4 inverse = glm::inverse(transforms.world[object]);
+    glm::vec3 localOrigin(inverse * glm::vec4(origin, 1.0f)), localDirection(inverse * glm::vec4(direction, 0.0f));
+    return intersectRayBox(localOrigin, glm::vec3(1.0f) / localDirection, glm::vec3(-0.5f), glm::vec3(0.5f), camera.Far, distance);
+  });
+}
+
+void CubeScene::printStats() {
+  std::cout << "STATS::SHADER::UNIFORM_LOOKUPS_AVOIDED " << Shader::lookupsAvoided << std::endl;
+  std::cout << "STATS::GL_STATE::ISSUED " << GLStateCache::issued << " ELIDED " << GLStateCache::elided << std::endl;
+  std::cout << "STATS::RENDER_QUEUE::SUBMITTED " << renderQueue.stats.submitted << " SORTED " << renderQueue.stats.sorted << " DRAWS " << renderQueue.stats.drawCalls
+            << " STATE_CHANGES " << renderQueue.stats.stateChanges() << std::endl;
+  std::cout << "STATS::CULLING::VISIBLE " << visibleCount << " OF " << cubeBounds.size() << std::endl;
+  std::cout << "STATS::TRANSFORMS::UPDATED " << changedTotal << " IN " << framesRendered << " FRAMES, "
+            << (framesRendered > 0 ? (double)changedTotal / framesRendered : 0.0) << " PER FRAME" << std::endl;
+  std::cout << "STATS::JOBS::EXECUTED " << jobs.executedJobs() << " STOLEN " << jobs.stolenJobs() << " THREADS " << jobs.threadCount() << std::endl;
+}
+
+void CubeScene::resetFrameStats() {
+  Shader::resetFrameStats();
+  GLStateCache::resetFrameStats();
+  renderQueue.resetFrameStats();
+  jobs.resetStats();
+}
+
+void CubeScene::destroy() {
+  cube->destroy();
+  delete cube;
+  cube = NULL;
+  frameUniforms.destroy();
+  textureLoader.destroy();
+  uploadRing.destroy();
+  shaderLibrary.destroy();
+}
@@ -0,0 +1,92 @@
+#ifndef CUBE_SCENE_H
+#define CUBE_SCENE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "../models/cube_model.hpp"
+#include "bvh.h"
+#include "camera.hpp"
+#include "frame_uniforms.hpp"
+#include "frustum_culling.h"
+#include "job_system.h"
+#include "pixel_upload_ring.h"
+#include "render_queue.h"
+#include "shader_library.hpp"
+#include "shader_permutations.h"
+#include "texture_loader.h"
+#include "transform_system.h"
+
+// the directory holding shaders/ and assets/ when nothing else is given: the build passes its own source tree, without
+// it src/ of the working directory, where a checkout is run from
+#ifdef SOURCE_ROOT
+const char *const DEFAULT_SOURCE_ROOT = SOURCE_ROOT;
+#else
+const char *const DEFAULT_SOURCE_ROOT = "src/";
+#endif
+
+/*
+ The ten textured cubes, everything a frame of them needs from the loaded programs to the draw. Owned by whatever
+ drives the frames (the window loop, a headless batch render, a benchmark), which only provides a current GL context,
+ a framebuffer and a camera, so all of them render exactly the same frame.
+*/
+class CubeScene {
+public:
+  static const unsigned int CUBE_COUNT = 10;
+  static const unsigned int MAX_JOB_THREADS = 4;
+
+  // threads worth giving the JobSystem passed in: ten cubes stay under every grain size, so most parallelFor calls run
+  // on the calling thread and more threads would only sit idle
+  static unsigned int jobThreads();
+
+  ShaderLibrary shaderLibrary;
+  ShaderPermutations defaultPrograms;
+  PixelUploadRing uploadRing;
+  TextureLoader textureLoader;
+  FrameUniforms frameUniforms;
+  RenderQueue renderQueue;
+
+  TransformSystem transforms;
+  CullingVolumes cubeBounds;
+  BVH cubeTree;
+
+  // of the last frame
+  size_t visibleCount;
+  size_t changedCount;
+  // over every frame rendered, most frames update no transform at all
+  size_t changedTotal;
+  unsigned int framesRendered;
+
+  // root ends with a slash, the programs are submitted and the textures queued before this returns
+  CubeScene(const std::string &root, JobSystem &jobs);
+
+  // blocks until every program is linked and every texture uploaded, so the first frame already looks like the rest
+  void finishLoading();
+
+  // updates and draws one frame into the bound framebuffer, which it clears first
+  void renderFrame(Camera &camera, float time, float deltaTime);
+
+  // the cube under the center of the screen, tested against the cube itself rather than its box
+  bool pick(Camera &camera, RayHit &hit);
+
+  // the counters of the last frame, and the transform updates of the whole run, as STATS:: lines
+  void printStats();
+  void resetFrameStats();
+
+  void destroy();
+
+private:
+  JobSystem &jobs;
+  TextureHandle woodTexture, awesomeTexture;
+  CubeModel *cube;
+
+  uint32_t changedCubes[CUBE_COUNT];
+  uint32_t visibleCubes[CUBE_COUNT];
+  unsigned int culledCameraVersion;
+
+  CubeScene(const CubeScene &);
+  CubeScene &operator=(const CubeScene &);
+};
+
+#endif
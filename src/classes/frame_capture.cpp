@@ -0,0 +1,253 @@
+#include <csignal>
+#include <cstring>
+#include <iostream>
+
+#include "frame_capture.h"
+#include "image_writer.h"
+
+FrameCapture::FrameCapture()
+    : width(0), height(0), format(CAPTURE_PNG), interval(1), running(false), oldest(0), pending(0), pipe(NULL), previousSigpipe(SIG_DFL), resized(0), stopping(false), captured(0), encoded(0), failed(0),
+      encodeSeconds(0.0) {
+  for (unsigned int i = 0; i < RING_SIZE; i++) {
+    ring[i].buffer = 0;
+    ring[i].fence = (GLsync)0;
+    ring[i].frame = 0;
+  }
+}
+
+FrameCapture::~FrameCapture() {
+  for (size_t i = 0; i < spare.size(); i++)
+    delete spare[i];
+}
+
+// encode() hands the pattern to snprintf with the frame number, so it may hold exactly one conversion of an unsigned
+// int (%u, %x, %X or %o with flags, width and precision) besides any number of %%
+static bool validPattern(const std::string &pattern) {
+  unsigned int conversions = 0;
+  for (size_t i = 0; i < pattern.size(); i++) {
+    if (pattern[i] != '%')
+      continue;
+    if (++i < pattern.size() && pattern[i] == '%')
+      continue;
+    while (i < pattern.size() && strchr("-+ #0", pattern[i]) != NULL)
+      i++;
+    while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9')
+      i++;
+    if (i < pattern.size() && pattern[i] == '.') {
+      i++;
+      while (i < pattern.size() && pattern[i] >= '0' && pattern[i] <= '9')
+        i++;
+    }
+    if (i >= pattern.size() || strchr("uxXo", pattern[i]) == NULL)
+      return false;
+    conversions++;
+  }
+  return conversions == 1;
+}
+
+bool FrameCapture::start(unsigned int width, unsigned int height, CaptureFormat format, const std::string &target, unsigned int interval) {
+  if (running || width == 0 || height == 0 || target.empty())
+    return false;
+  if (format != CAPTURE_PIPE && !validPattern(target)) {
+    std::cout << "ERROR::CAPTURE::INVALID_PATTERN " << target << ", needs one %u for the frame number" << std::endl;
+    return false;
+  }
+
+  if (format == CAPTURE_PIPE) {
+    // a command that exits early must fail the writes, not kill us. The handler is the process's, stop() puts it back
+    previousSigpipe = signal(SIGPIPE, SIG_IGN);
+    pipe = popen(target.c_str(), "w");
+    if (pipe == NULL) {
+      signal(SIGPIPE, previousSigpipe);
+      std::cout << "ERROR::CAPTURE::PIPE_NOT_OPENED " << target << std::endl;
+      return false;
+    }
+  }
+
+  this->width = width;
+  this->height = height;
+  this->format = format;
+  this->target = target;
+  this->interval = interval > 0 ? interval : 1;
+
+  size_t size = (size_t)width * height * 4;
+  for (unsigned int i = 0; i < RING_SIZE; i++) {
+    glGenBuffers(1, &ring[i].buffer);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, ring[i].buffer);
+    glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  oldest = pending = 0;
+  resized = 0;
+  captured = encoded = failed = 0;
+  encodeSeconds = 0.0;
+  stopping = false;
+  running = true;
+  startTime = std::chrono::steady_clock::now();
+  encoder = std::thread(&FrameCapture::encoderLoop, this);
+  return true;
+}
+
+void FrameCapture::capture(unsigned int frame, unsigned int width, unsigned int height) {
+  if (!running)
+    return;
+
+  // whatever has arrived goes to the encoder, the flush makes sure the fences get to the GPU at all
+  while (pending > 0) {
+    GLenum status = glClientWaitSync(ring[oldest].fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+      break;
+    collect(ring[oldest]);
+  }
+
+  if (frame % interval != 0)
+    return;
+  if (width != this->width || height != this->height) {
+    if (resized++ == 0)
+      std::cout << "ERROR::CAPTURE::SIZE_CHANGED " << width << "x" << height << " INSTEAD OF " << this->width << "x" << this->height << ", frames are skipped"
+                << std::endl;
+    return;
+  }
+
+  // the GPU is a whole ring behind, nothing left but to wait for it
+  if (pending == RING_SIZE)
+    collect(ring[oldest]);
+
+  Readback &readback = ring[(oldest + pending) % RING_SIZE];
+  readback.frame = frame;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  glReadPixels(0, 0, this->width, this->height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  pending++;
+  captured++;
+}
+
+void FrameCapture::collect(Readback &readback) {
+  while (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+  }
+  glDeleteSync(readback.fence);
+  readback.fence = (GLsync)0;
+  oldest = (oldest + 1) % RING_SIZE;
+  pending--;
+
+  CapturedFrame *frame = NULL;
+  {
+    std::unique_lock<std::mutex> lock(queueMutex);
+    // a slow encoder holds the render loop back here rather than letting the queue grow without bound
+    while (queue.size() >= MAX_QUEUED)
+      queueChanged.wait(lock);
+    if (!spare.empty()) {
+      frame = spare.back();
+      spare.pop_back();
+    }
+  }
+  if (frame == NULL)
+    frame = new CapturedFrame();
+  frame->number = readback.frame;
+  frame->pixels.resize((size_t)width * height * 4);
+
+  // GL rows start at the bottom, the image formats start at the top
+  size_t stride = (size_t)width * 4;
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  const unsigned char *pixels = (const unsigned char *)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, stride * height, GL_MAP_READ_BIT);
+  if (pixels != NULL) {
+    for (unsigned int y = 0; y < height; y++)
+      memcpy(&frame->pixels[y * stride], pixels + (height - 1 - y) * stride, stride);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  std::lock_guard<std::mutex> lock(queueMutex);
+  if (pixels == NULL) {
+    failed++;
+    spare.push_back(frame);
+    return;
+  }
+  queue.push_back(frame);
+  queueChanged.notify_all();
+}
+
+void FrameCapture::encoderLoop() {
+  for (;;) {
+    CapturedFrame *frame;
+    {
+      std::unique_lock<std::mutex> lock(queueMutex);
+      while (queue.empty() && !stopping)
+        queueChanged.wait(lock);
+      if (queue.empty())
+        return;
+      frame = queue.front();
+      queue.pop_front();
+    }
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    bool written = encode(*frame);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::lock_guard<std::mutex> lock(queueMutex);
+    if (written)
+      encoded++;
+    else
+      failed++;
+    encodeSeconds += seconds;
+    spare.push_back(frame);
+    queueChanged.notify_all();
+  }
+}
+
+bool FrameCapture::encode(const CapturedFrame &frame) {
+  if (format == CAPTURE_PIPE)
+    return fwrite(&frame.pixels[0], 1, frame.pixels.size(), pipe) == frame.pixels.size();
+
+  char path[1024];
+  snprintf(path, sizeof(path), target.c_str(), frame.number);
+  if (format == CAPTURE_QOI)
+    return writeQOI(path, &frame.pixels[0], width, height);
+  return writePNG(path, &frame.pixels[0], width, height);
+}
+
+void FrameCapture::stop() {
+  if (!running)
+    return;
+
+  while (pending > 0)
+    collect(ring[oldest]);
+  {
+    std::lock_guard<std::mutex> lock(queueMutex);
+    stopping = true;
+  }
+  queueChanged.notify_all();
+  encoder.join();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+  if (pipe != NULL) {
+    if (pclose(pipe) != 0)
+      std::cout << "ERROR::CAPTURE::PIPE_COMMAND_FAILED " << target << std::endl;
+    pipe = NULL;
+    signal(SIGPIPE, previousSigpipe);
+  }
+  for (unsigned int i = 0; i < RING_SIZE; i++) {
+    glDeleteBuffers(1, &ring[i].buffer);
+    ring[i].buffer = 0;
+  }
+  running = false;
+
+  std::cout << "CAPTURE::WROTE " << encoded << " FRAMES AT " << width << "x" << height << " IN " << seconds * 1000.0 << " ms, " << (seconds > 0.0 ? encoded / seconds : 0.0)
+            << " FRAMES/S, ENCODER " << (encodeSeconds > 0.0 ? encoded / encodeSeconds : 0.0) << " FRAMES/S" << std::endl;
+  if (failed > 0)
+    std::cout << "ERROR::CAPTURE::FRAMES_LOST " << failed << std::endl;
+  if (resized > 0)
+    std::cout << "ERROR::CAPTURE::FRAMES_SKIPPED " << resized << " OF ANOTHER SIZE" << std::endl;
+}
+
+void FrameCapture::printStats() const {
+  if (!running)
+    return;
+  std::lock_guard<std::mutex> lock(queueMutex);
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+  std::cout << "STATS::CAPTURE::CAPTURED " << captured << " ENCODED " << encoded << " QUEUED " << queue.size() << " " << (seconds > 0.0 ? encoded / seconds : 0.0)
+            << " FRAMES/S ENCODER " << (encodeSeconds > 0.0 ? encoded / encodeSeconds : 0.0) << " FRAMES/S" << std::endl;
+}
@@ -0,0 +1,95 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum CaptureFormat {
+  CAPTURE_PNG,
+  CAPTURE_QOI,
+  CAPTURE_PIPE // raw RGBA8 frames, top row first, written to the standard input of a command (ffmpeg -f rawvideo ...)
+};
+
+/*
+ Saves rendered frames without stalling the render loop. capture() only starts an asynchronous glReadPixels into one
+ of a ring of GL_PIXEL_PACK_BUFFERs and fences it; a later capture() maps the buffer once its fence has signaled and
+ hands the pixels to an encoder thread, which writes the files or feeds the pipe. The frame only waits when the GPU
+ is a whole ring behind, or when the encoder falls MAX_QUEUED frames behind, so a slow disk cannot use up memory.
+*/
+class FrameCapture {
+public:
+  static const unsigned int RING_SIZE = 3;
+  static const unsigned int MAX_QUEUED = 8;
+
+  FrameCapture();
+  ~FrameCapture();
+
+  // target is a printf pattern taking the frame number for files ("frames/%05u.png"), or the command for CAPTURE_PIPE.
+  // A pattern without exactly one unsigned conversion is refused. Every interval-th frame is captured
+  bool start(unsigned int width, unsigned int height, CaptureFormat format, const std::string &target, unsigned int interval = 1);
+
+  bool active() const { return running; }
+
+  // GL thread, after the frame was drawn: reads the pixels of the framebuffer bound for reading when frame is on the
+  // interval, and passes on the earlier readbacks that have arrived. width and height are the framebuffer's current
+  // size, frames of another size than start() was given are skipped, a stream or a numbered sequence has one size
+  void capture(unsigned int frame, unsigned int width, unsigned int height);
+
+  // GL thread: waits for the readbacks in flight and for the encoder, then reports the throughput
+  void stop();
+
+  void printStats() const;
+
+private:
+  struct Readback {
+    unsigned int buffer;
+    GLsync fence;
+    unsigned int frame;
+  };
+
+  struct CapturedFrame {
+    unsigned int number;
+    std::vector<unsigned char> pixels;
+  };
+
+  unsigned int width, height;
+  CaptureFormat format;
+  std::string target;
+  unsigned int interval;
+  bool running;
+
+  Readback ring[RING_SIZE];
+  unsigned int oldest, pending;
+
+  FILE *pipe;
+  void (*previousSigpipe)(int); // restored by stop()
+  unsigned int resized;         // frames skipped because the framebuffer size changed
+  std::thread encoder;
+  mutable std::mutex queueMutex;
+  std::condition_variable queueChanged;
+  std::deque<CapturedFrame *> queue;
+  std::vector<CapturedFrame *> spare; // encoded frames, recycled so capturing does not allocate
+  bool stopping;
+
+  std::atomic<unsigned int> captured, encoded, failed;
+  double encodeSeconds; // encoder thread only until stop() joins it
+  std::chrono::steady_clock::time_point startTime;
+
+  void collect(Readback &readback);
+  void encoderLoop();
+  bool encode(const CapturedFrame &frame);
+
+  FrameCapture(const FrameCapture &);
+  FrameCapture &operator=(const FrameCapture &);
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef FRAME_UNIFORMS_H
+#define FRAME_UNIFORMS_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+
+#include "camera.hpp"
+
+// the uniform buffer binding point FrameUniforms lives at, every program's block is pointed here at link time
+const unsigned int FRAME_UNIFORMS_BINDING = 0;
+const char *const FRAME_UNIFORMS_BLOCK = "FrameUniforms";
+
+// mirrors the std140 block in shaders/common/frame_uniforms.glsl: mat4s are four vec4 columns, the vec3 is padded to a vec4
+struct FrameUniformData {
+  glm::mat4 view;
+  glm::mat4 projection;
+  glm::mat4 viewProjection;
+  glm::vec4 cameraPosition; // w unused
+  float time;
+  float deltaTime;
+  float padding[2]; // std140 rounds the block up to a multiple of 16 bytes
+};
+
+static_assert(sizeof(FrameUniformData) == 224, "FrameUniformData must match the std140 layout of FrameUniforms");
+
+/*
+ Per frame camera data in one uniform buffer, shared by every program through a fixed binding point. It is written
+ once per frame, however many programs read it, instead of a setMat4 per program and matrix.
+*/
+class FrameUniforms {
+public:
+  unsigned int UBO;
+
+  FrameUniforms() : cameraVersion(0) {
+    glGenBuffers(1, &UBO);
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), NULL, GL_STREAM_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UBO);
+  }
+
+  void update(const FrameUniformData &data) {
+    // orphan last frame's copy, a draw still reading it must not make this upload wait
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformData), &data);
+  }
+
+  void update(const glm::mat4 &view, const glm::mat4 &projection, const glm::vec3 &cameraPosition, float time, float deltaTime) {
+    FrameUniformData data;
+    data.view = view;
+    data.projection = projection;
+    data.viewProjection = projection * view;
+    data.cameraPosition = glm::vec4(cameraPosition, 1.0f);
+    data.time = time;
+    data.deltaTime = deltaTime;
+    data.padding[0] = data.padding[1] = 0.0f;
+    update(data);
+  }
+
+  // uploads the camera matrices only when the camera changed since the last call, otherwise just the two clocks
+  void update(Camera &camera, float time, float deltaTime) {
+    if (camera.GetVersion() != cameraVersion) {
+      update(camera.GetViewMatrix(), camera.GetProjectionMatrix(), camera.Position, time, deltaTime);
+      cameraVersion = camera.GetVersion();
+      return;
+    }
+
+    // no orphaning here: that would throw away the matrices that are still valid
+    float clocks[2] = {time, deltaTime};
+    glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, offsetof(FrameUniformData, time), sizeof(clocks), clocks);
+  }
+
+  void destroy() { glDeleteBuffers(1, &UBO); }
+
+private:
+  unsigned int cameraVersion; // 0 is never a camera's version, so the first update is a full one. Versions are unique across cameras
+};
+
+#endif
@@ -0,0 +1,43 @@
+#include <iostream>
+
+#include "framebuffer.h"
+#include "gl_state_cache.h"
+
+bool Framebuffer::create(unsigned int width, unsigned int height) {
+  this->width = width;
+  this->height = height;
+
+  glGenTextures(1, &colorTexture);
+  GLStateCache::bindTexture(colorTexture);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+  glGenRenderbuffers(1, &depthBuffer);
+  glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+  glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+  glGenFramebuffers(1, &ID);
+  glBindFramebuffer(GL_FRAMEBUFFER, ID);
+  glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+  glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+  if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+    std::cout << "ERROR::FRAMEBUFFER::INCOMPLETE " << width << "x" << height << std::endl;
+    return false;
+  }
+  bind();
+  return true;
+}
+
+void Framebuffer::bind() {
+  glBindFramebuffer(GL_FRAMEBUFFER, ID);
+  glViewport(0, 0, width, height);
+}
+
+void Framebuffer::destroy() {
+  GLStateCache::forgetTexture(colorTexture);
+  glDeleteFramebuffers(1, &ID);
+  glDeleteRenderbuffers(1, &depthBuffer);
+  glDeleteTextures(1, &colorTexture);
+  ID = colorTexture = depthBuffer = 0;
+}
@@ -0,0 +1,25 @@
+#ifndef FRAMEBUFFER_H
+#define FRAMEBUFFER_H
+
+#include <glad/glad.h>
+
+// An offscreen render target: an RGBA8 color texture and a 24 bit depth buffer of a fixed size
+class Framebuffer {
+public:
+  unsigned int ID;
+  unsigned int colorTexture;
+  unsigned int depthBuffer;
+  unsigned int width, height;
+
+  Framebuffer() : ID(0), colorTexture(0), depthBuffer(0), width(0), height(0) {}
+
+  // leaves the framebuffer bound, returns false if the driver does not accept it
+  bool create(unsigned int width, unsigned int height);
+
+  // binds it for drawing and reading, and sets the viewport to all of it
+  void bind();
+
+  void destroy();
+};
+
+#endif
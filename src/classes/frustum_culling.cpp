@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "frustum_culling.h"
+#include "job_system.h"
+
+// boxes per job of the threaded cull
+static const size_t CULL_RANGE = 16384;
+
+Frustum Frustum::fromMatrix(const glm::mat4 &m) {
+  // glm is column major, m[column][row]
+  glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+  glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+  glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+  glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+  Frustum frustum;
+  frustum.planes[0] = row3 + row0;
+  frustum.planes[1] = row3 - row0;
+  frustum.planes[2] = row3 + row1;
+  frustum.planes[3] = row3 - row1;
+  frustum.planes[4] = row3 + row2;
+  frustum.planes[5] = row3 - row2;
+
+  // normalized, so the box test compares real distances
+  for (int i = 0; i < 6; i++)
+    frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+  return frustum;
+}
+
+size_t CullingVolumes::add(const glm::vec3 &center, const glm::vec3 &extents) {
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extents.x);
+  extentY.push_back(extents.y);
+  extentZ.push_back(extents.z);
+  return centerX.size() - 1;
+}
+
+void CullingVolumes::set(size_t index, const glm::vec3 &center, const glm::vec3 &extents) {
+  centerX[index] = center.x;
+  centerY[index] = center.y;
+  centerZ[index] = center.z;
+  extentX[index] = extents.x;
+  extentY[index] = extents.y;
+  extentZ[index] = extents.z;
+}
+
+// Arvo: each world extent is the sum of the local extents projected on that axis
+static glm::vec3 transformExtents(const glm::mat4 &transform, const glm::vec3 &localExtents) {
+  glm::vec3 extents;
+  for (int axis = 0; axis < 3; axis++)
+    extents[axis] = fabsf(transform[0][axis]) * localExtents.x + fabsf(transform[1][axis]) * localExtents.y + fabsf(transform[2][axis]) * localExtents.z;
+  return extents;
+}
+
+size_t CullingVolumes::add(const glm::mat4 &transform, const glm::vec3 &localExtents) {
+  return add(glm::vec3(transform[3]), transformExtents(transform, localExtents));
+}
+
+void CullingVolumes::set(size_t index, const glm::mat4 &transform, const glm::vec3 &localExtents) {
+  set(index, glm::vec3(transform[3]), transformExtents(transform, localExtents));
+}
+
+void CullingVolumes::clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+}
+
+void CullingVolumes::reserve(size_t count) {
+  centerX.reserve(count);
+  centerY.reserve(count);
+  centerZ.reserve(count);
+  extentX.reserve(count);
+  extentY.reserve(count);
+  extentZ.reserve(count);
+}
+
+/*
+ A box is outside when it is entirely behind one plane: the distance of its center plus its extent projected on the
+ plane normal (|n.x| * e.x + |n.y| * e.y + |n.z| * e.z) is negative. Boxes crossing a plane count as visible.
+*/
+size_t CullingVolumes::cullScalar(const Frustum &frustum, uint32_t *visible, size_t begin, size_t end) const {
+  size_t count = 0;
+  for (size_t i = begin; i < end; i++) {
+    bool inside = true;
+    for (int p = 0; p < 6 && inside; p++) {
+      const glm::vec4 &plane = frustum.planes[p];
+      float distance = plane.x * centerX[i] + plane.y * centerY[i] + plane.z * centerZ[i] + plane.w;
+      float radius = fabsf(plane.x) * extentX[i] + fabsf(plane.y) * extentY[i] + fabsf(plane.z) * extentZ[i];
+      inside = distance + radius >= 0.0f;
+    }
+    visible[count] = (uint32_t)i;
+    count += inside; // branchless compaction, a culled index is simply overwritten by the next one
+  }
+  return count;
+}
+
+size_t CullingVolumes::cull(const Frustum &frustum, uint32_t *visible) const { return cullRange(frustum, visible, 0, size()); }
+
+size_t CullingVolumes::cull(const Frustum &frustum, uint32_t *visible, JobSystem &jobs) const {
+  size_t n = size();
+  uint32_t ranges = (uint32_t)((n + CULL_RANGE - 1) / CULL_RANGE);
+  if (ranges < 2 || jobs.threadCount() < 2)
+    return cull(frustum, visible);
+
+  // each range writes its visible boxes where its own boxes start, no other range writes there
+  std::vector<size_t> counts(ranges);
+  jobs.parallelFor(ranges, 1, [&](uint32_t begin, uint32_t end) {
+    for (uint32_t range = begin; range < end; range++) {
+      size_t first = range * CULL_RANGE;
+      counts[range] = cullRange(frustum, visible + first, first, std::min(n, first + CULL_RANGE));
+    }
+  });
+
+  // then they move down to follow each other, still in increasing order
+  size_t count = counts[0];
+  for (uint32_t range = 1; range < ranges; range++) {
+    memmove(visible + count, visible + range * CULL_RANGE, counts[range] * sizeof(uint32_t));
+    count += counts[range];
+  }
+  return count;
+}
+
+size_t CullingVolumes::cullRange(const Frustum &frustum, uint32_t *visible, size_t begin, size_t end) const {
+  size_t count = 0;
+  size_t i = begin;
+  size_t n = end;
+
+#if defined(__AVX__)
+  __m256 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+  __m256 signMask = _mm256_set1_ps(-0.0f);
+  for (int p = 0; p < 6; p++) {
+    planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+    planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+    planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+    planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+    absX[p] = _mm256_andnot_ps(signMask, planeX[p]);
+    absY[p] = _mm256_andnot_ps(signMask, planeY[p]);
+    absZ[p] = _mm256_andnot_ps(signMask, planeZ[p]);
+  }
+
+  for (; i + 8 <= n; i += 8) {
+    __m256 cx = _mm256_loadu_ps(&centerX[i]), cy = _mm256_loadu_ps(&centerY[i]), cz = _mm256_loadu_ps(&centerZ[i]);
+    __m256 ex = _mm256_loadu_ps(&extentX[i]), ey = _mm256_loadu_ps(&extentY[i]), ez = _mm256_loadu_ps(&extentZ[i]);
+    __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+
+    for (int p = 0; p < 6; p++) {
+      __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)), _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+      __m256 radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+
+    int mask = _mm256_movemask_ps(inside);
+    for (int lane = 0; lane < 8; lane++) {
+      visible[count] = (uint32_t)(i + lane);
+      count += (mask >> lane) & 1;
+    }
+  }
+#elif defined(__SSE2__)
+  __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+  __m128 signMask = _mm_set1_ps(-0.0f);
+  for (int p = 0; p < 6; p++) {
+    planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+    planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+    planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+    planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+    absX[p] = _mm_andnot_ps(signMask, planeX[p]);
+    absY[p] = _mm_andnot_ps(signMask, planeY[p]);
+    absZ[p] = _mm_andnot_ps(signMask, planeZ[p]);
+  }
+
+  for (; i + 4 <= n; i += 4) {
+    __m128 cx = _mm_loadu_ps(&centerX[i]), cy = _mm_loadu_ps(&centerY[i]), cz = _mm_loadu_ps(&centerZ[i]);
+    __m128 ex = _mm_loadu_ps(&extentX[i]), ey = _mm_loadu_ps(&extentY[i]), ez = _mm_loadu_ps(&extentZ[i]);
+    __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+
+    for (int p = 0; p < 6; p++) {
+      __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)), _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+      __m128 radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+
+    int mask = _mm_movemask_ps(inside);
+    for (int lane = 0; lane < 4; lane++) {
+      visible[count] = (uint32_t)(i + lane);
+      count += (mask >> lane) & 1;
+    }
+  }
+#endif
+
+  // whatever did not fill a register
+  return count + cullScalar(frustum, visible + count, i, n);
+}
@@ -0,0 +1,59 @@
+#ifndef FRUSTUM_CULLING_H
+#define FRUSTUM_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class JobSystem;
+
+// six planes (x, y, z, w) with normals pointing inwards, a point p is inside a plane when dot(xyz, p) + w >= 0
+struct Frustum {
+  glm::vec4 planes[6]; // left, right, bottom, top, near, far
+
+  // Gribb-Hartmann: the planes are sums and differences of the rows of the view-projection matrix
+  static Frustum fromMatrix(const glm::mat4 &viewProjection);
+};
+
+/*
+ Axis aligned bounding boxes, stored as center and half extents in one array per component (structure of arrays),
+ so the plane tests load 4 (SSE) or 8 (AVX) boxes per register instead of gathering them.
+*/
+class CullingVolumes {
+public:
+  std::vector<float> centerX, centerY, centerZ;
+  std::vector<float> extentX, extentY, extentZ;
+
+  size_t size() const { return centerX.size(); }
+  glm::vec3 center(size_t index) const { return glm::vec3(centerX[index], centerY[index], centerZ[index]); }
+  glm::vec3 extents(size_t index) const { return glm::vec3(extentX[index], extentY[index], extentZ[index]); }
+
+  // returns the index of the new box
+  size_t add(const glm::vec3 &center, const glm::vec3 &extents);
+  void set(size_t index, const glm::vec3 &center, const glm::vec3 &extents);
+
+  // the world space box around a box of the given half extents centered on the origin of transform's space
+  size_t add(const glm::mat4 &transform, const glm::vec3 &localExtents);
+  void set(size_t index, const glm::mat4 &transform, const glm::vec3 &localExtents);
+  void clear();
+  void reserve(size_t count);
+
+  /*
+   Writes the indices of the boxes that intersect the frustum to visible (room for size() entries) in increasing
+   order and returns how many there are. Boxes are tested 8 or 4 at a time when the compiler targets AVX or SSE2.
+  */
+  size_t cull(const Frustum &frustum, uint32_t *visible) const;
+
+  // the same result, with ranges of boxes culled on all threads of jobs and then moved together
+  size_t cull(const Frustum &frustum, uint32_t *visible, JobSystem &jobs) const;
+
+  // the same test one box at a time, the reference the SIMD paths are measured against
+  size_t cullScalar(const Frustum &frustum, uint32_t *visible, size_t begin = 0) const { return cullScalar(frustum, visible, begin, size()); }
+
+private:
+  size_t cullRange(const Frustum &frustum, uint32_t *visible, size_t begin, size_t end) const;
+  size_t cullScalar(const Frustum &frustum, uint32_t *visible, size_t begin, size_t end) const;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#include <glad/glad.h>
+
+#include <cstring>
+
+#include "gl_extensions.h"
+
+bool GLExtensions::bufferStorage = false;
+PFN_BUFFER_STORAGE GLExtensions::BufferStorage = NULL;
+bool GLExtensions::textureCompressionS3TC = false;
+bool GLExtensions::textureCompressionBPTC = false;
+bool GLExtensions::programBinary = false;
+PFN_GET_PROGRAM_BINARY GLExtensions::GetProgramBinary = NULL;
+PFN_PROGRAM_BINARY GLExtensions::ProgramBinary = NULL;
+PFN_PROGRAM_PARAMETERI GLExtensions::ProgramParameteri = NULL;
+bool GLExtensions::parallelShaderCompile = false;
+PFN_MAX_SHADER_COMPILER_THREADS GLExtensions::MaxShaderCompilerThreads = NULL;
+
+bool GLExtensions::has(const char *extension) {
+  int count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (int i = 0; i < count; i++) {
+    const char *name = (const char *)glGetStringi(GL_EXTENSIONS, i);
+    if (name && strcmp(name, extension) == 0)
+      return true;
+  }
+  return false;
+}
+
+int GLExtensions::version() {
+  int major = 0, minor = 0;
+  glGetIntegerv(GL_MAJOR_VERSION, &major);
+  glGetIntegerv(GL_MINOR_VERSION, &minor);
+  return major * 10 + minor;
+}
+
+void GLExtensions::load(GLADloadproc loader) {
+  int glVersion = version();
+
+  if (glVersion >= 44 || has("GL_ARB_buffer_storage")) {
+    BufferStorage = (PFN_BUFFER_STORAGE)loader("glBufferStorage");
+    bufferStorage = BufferStorage != NULL;
+  }
+
+  textureCompressionS3TC = has("GL_EXT_texture_compression_s3tc");
+  textureCompressionBPTC = glVersion >= 42 || has("GL_ARB_texture_compression_bptc");
+
+  if (glVersion >= 41 || has("GL_ARB_get_program_binary")) {
+    GetProgramBinary = (PFN_GET_PROGRAM_BINARY)loader("glGetProgramBinary");
+    ProgramBinary = (PFN_PROGRAM_BINARY)loader("glProgramBinary");
+    ProgramParameteri = (PFN_PROGRAM_PARAMETERI)loader("glProgramParameteri");
+
+    // some drivers expose the entry points but no format to save in
+    int formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    programBinary = GetProgramBinary != NULL && ProgramBinary != NULL && ProgramParameteri != NULL && formats > 0;
+  }
+
+  if (has("GL_KHR_parallel_shader_compile")) {
+    MaxShaderCompilerThreads = (PFN_MAX_SHADER_COMPILER_THREADS)loader("glMaxShaderCompilerThreadsKHR");
+    parallelShaderCompile = true;
+  } else if (has("GL_ARB_parallel_shader_compile")) {
+    MaxShaderCompilerThreads = (PFN_MAX_SHADER_COMPILER_THREADS)loader("glMaxShaderCompilerThreadsARB");
+    parallelShaderCompile = true;
+  }
+}
@@ -0,0 +1,68 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+// glad is generated for plain GL 3.3 core, so newer entry points and tokens are resolved here at runtime
+
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+#ifndef APIENTRYP
+#define APIENTRYP APIENTRY *
+#endif
+
+typedef void(APIENTRYP PFN_BUFFER_STORAGE)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+typedef void(APIENTRYP PFN_GET_PROGRAM_BINARY)(GLuint program, GLsizei bufSize, GLsizei *length, GLenum *binaryFormat, void *binary);
+typedef void(APIENTRYP PFN_PROGRAM_BINARY)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+typedef void(APIENTRYP PFN_PROGRAM_PARAMETERI)(GLuint program, GLenum pname, GLint value);
+typedef void(APIENTRYP PFN_MAX_SHADER_COMPILER_THREADS)(GLuint count);
+
+class GLExtensions {
+public:
+  // GL_ARB_buffer_storage (core in 4.4)
+  static bool bufferStorage;
+  static PFN_BUFFER_STORAGE BufferStorage;
+
+  // GL_EXT_texture_compression_s3tc (BC1 - BC3) and GL_ARB_texture_compression_bptc (BC7, core in 4.2)
+  static bool textureCompressionS3TC;
+  static bool textureCompressionBPTC;
+
+  // GL_ARB_get_program_binary (core in 4.1), and only when the driver offers at least one binary format
+  static bool programBinary;
+  static PFN_GET_PROGRAM_BINARY GetProgramBinary;
+  static PFN_PROGRAM_BINARY ProgramBinary;
+  static PFN_PROGRAM_PARAMETERI ProgramParameteri;
+
+  // GL_KHR_parallel_shader_compile (or the ARB one): GL_COMPLETION_STATUS_KHR can be polled without blocking
+  static bool parallelShaderCompile;
+  static PFN_MAX_SHADER_COMPILER_THREADS MaxShaderCompilerThreads;
+
+  // call once after gladLoadGLLoader, with the same loader
+  static void load(GLADloadproc loader);
+
+  static bool has(const char *extension);
+
+  // version of the current context, e.g. 33 or 46
+  static int version();
+};
+
+#endif
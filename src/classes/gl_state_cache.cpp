@@ -0,0 +1,102 @@
+#include <glad/glad.h>
+
+#include "gl_state_cache.h"
+
+// -1 means unknown, so the first bind after an invalidate() is always issued
+unsigned int GLStateCache::issued = 0;
+unsigned int GLStateCache::elided = 0;
+int GLStateCache::program = -1;
+int GLStateCache::vertexArray = -1;
+int GLStateCache::activeUnit = -1;
+int GLStateCache::textures[GLStateCache::MAX_TEXTURE_UNITS] = {-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                                              -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+void GLStateCache::useProgram(unsigned int id) {
+  if (program == (int)id) {
+    elided++;
+    return;
+  }
+  glUseProgram(id);
+  program = id;
+  issued++;
+}
+
+void GLStateCache::bindVertexArray(unsigned int vao) {
+  if (vertexArray == (int)vao) {
+    elided++;
+    return;
+  }
+  glBindVertexArray(vao);
+  vertexArray = vao;
+  issued++;
+}
+
+void GLStateCache::activeTexture(unsigned int unit) {
+  if (activeUnit == (int)unit) {
+    elided++;
+    return;
+  }
+  glActiveTexture(GL_TEXTURE0 + unit);
+  activeUnit = unit;
+  issued++;
+}
+
+void GLStateCache::bindTexture(unsigned int texture) {
+  // the active unit is unknown until someone sets it, GL starts on unit 0
+  if (activeUnit < 0)
+    activeTexture(0);
+
+  // units past the shadow copy are not cached, the bind always goes through
+  if (activeUnit >= (int)MAX_TEXTURE_UNITS) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    issued++;
+    return;
+  }
+  if (textures[activeUnit] == (int)texture) {
+    elided++;
+    return;
+  }
+  glBindTexture(GL_TEXTURE_2D, texture);
+  textures[activeUnit] = texture;
+  issued++;
+}
+
+void GLStateCache::bindTexture(unsigned int unit, unsigned int texture) {
+  if (unit < MAX_TEXTURE_UNITS && textures[unit] == (int)texture) {
+    // neither the unit switch nor the bind is needed
+    elided += 2;
+    return;
+  }
+  activeTexture(unit);
+  bindTexture(texture);
+}
+
+void GLStateCache::forgetProgram(unsigned int id) {
+  if (program == (int)id)
+    program = -1;
+}
+
+void GLStateCache::forgetVertexArray(unsigned int vao) {
+  if (vertexArray == (int)vao)
+    vertexArray = -1;
+}
+
+void GLStateCache::forgetTexture(unsigned int texture) {
+  for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++) {
+    if (textures[i] == (int)texture)
+      textures[i] = -1;
+  }
+}
+
+void GLStateCache::invalidate() {
+  program = -1;
+  vertexArray = -1;
+  activeUnit = -1;
+  for (unsigned int i = 0; i < MAX_TEXTURE_UNITS; i++)
+    textures[i] = -1;
+}
+
+void GLStateCache::resetFrameStats() {
+  issued = 0;
+  elided = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef GL_STATE_CACHE_H
+#define GL_STATE_CACHE_H
+
+#include <glad/glad.h>
+
+// Shadows the bound program, VAO, active texture unit and the GL_TEXTURE_2D binding of each unit,
+// so binds that would not change anything never reach the driver.
+// Everything that binds these objects has to go through here, otherwise the shadow copy goes stale.
+class GLStateCache {
+public:
+  static const unsigned int MAX_TEXTURE_UNITS = 32; // binds on higher units go straight to the driver
+
+  // state changes sent to the driver / skipped because they were no-ops, since the last resetFrameStats()
+  static unsigned int issued;
+  static unsigned int elided;
+
+  static void useProgram(unsigned int program);
+  static void bindVertexArray(unsigned int vao);
+
+  // unit is an index (0, 1, ...), not GL_TEXTURE0 + index
+  static void activeTexture(unsigned int unit);
+
+  // binds a 2D texture to the active unit
+  static void bindTexture(unsigned int texture);
+
+  // binds a 2D texture to the given unit, only switching the active unit if the binding actually changes
+  static void bindTexture(unsigned int unit, unsigned int texture);
+
+  // call before deleting an object, GL silently unbinds deleted objects and their names can be reused
+  static void forgetProgram(unsigned int program);
+  static void forgetVertexArray(unsigned int vao);
+  static void forgetTexture(unsigned int texture);
+
+  // forget everything, for when GL state was changed behind the cache's back
+  static void invalidate();
+
+  static void resetFrameStats();
+
+private:
+  static int program;
+  static int vertexArray;
+  static int activeUnit;
+  static int textures[MAX_TEXTURE_UNITS];
+};
+
+#endif
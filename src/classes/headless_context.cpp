@@ -0,0 +1,119 @@
+#include <cstring>
+#include <iostream>
+
+#include "gl_extensions.h"
+#include "headless_context.h"
+
+#ifdef HAVE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+#endif
+
+HeadlessContext::HeadlessContext() : display(NULL), context(NULL) {}
+
+#ifdef HAVE_EGL
+
+static bool hasExtension(const char *extensions, const char *name) {
+  if (extensions == NULL)
+    return false;
+  size_t length = strlen(name);
+  for (const char *found = strstr(extensions, name); found != NULL; found = strstr(found + length, name)) {
+    if ((found == extensions || found[-1] == ' ') && (found[length] == ' ' || found[length] == '\0'))
+      return true;
+  }
+  return false;
+}
+
+// without a display server: Mesa's surfaceless platform first, then whatever the default display is
+static EGLDisplay openDisplay() {
+  const char *clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+  if (hasExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay != NULL) {
+      EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+      if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+        return display;
+    }
+  }
+
+  EGLDisplay display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+  if (display != EGL_NO_DISPLAY && eglInitialize(display, NULL, NULL))
+    return display;
+  return EGL_NO_DISPLAY;
+}
+
+bool HeadlessContext::create(unsigned int width, unsigned int height) {
+  EGLDisplay eglDisplay = openDisplay();
+  if (eglDisplay == EGL_NO_DISPLAY) {
+    std::cout << "ERROR::HEADLESS::NO_EGL_DISPLAY" << std::endl;
+    return false;
+  }
+  display = eglDisplay;
+  if (!hasExtension(eglQueryString(eglDisplay, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context")) {
+    std::cout << "ERROR::HEADLESS::NO_SURFACELESS_CONTEXT" << std::endl;
+    return false;
+  }
+
+  // nothing is drawn to an EGL surface, the config only has to be able to make a desktop GL context
+  const EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+  EGLConfig config;
+  EGLint configCount = 0;
+  if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount)) {
+    std::cout << "ERROR::HEADLESS::NO_OPENGL_API" << std::endl;
+    return false;
+  }
+
+  // surfaceless displays may have no configs at all, EGL_KHR_no_config_context makes that fine
+  const EGLint contextAttributes[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 3, EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                                      EGL_NONE};
+  EGLContext eglContext = eglCreateContext(eglDisplay, configCount > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttributes);
+  if (eglContext == EGL_NO_CONTEXT) {
+    std::cout << "ERROR::HEADLESS::CONTEXT_CREATION_FAILED 0x" << std::hex << eglGetError() << std::dec << std::endl;
+    return false;
+  }
+  context = eglContext;
+  if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+    std::cout << "ERROR::HEADLESS::MAKE_CURRENT_FAILED" << std::endl;
+    return false;
+  }
+
+  // Mesa hands out core functions through eglGetProcAddress too (EGL_KHR_get_all_proc_addresses)
+  if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+    std::cout << "Failed to initialize GLAD" << std::endl;
+    return false;
+  }
+  GLExtensions::load((GLADloadproc)eglGetProcAddress);
+
+  if (!target.create(width, height))
+    return false;
+
+  std::cout << "GL_RENDERER " << glGetString(GL_RENDERER) << std::endl;
+  std::cout << "GL_VERSION " << glGetString(GL_VERSION) << std::endl;
+  return true;
+}
+
+void HeadlessContext::destroy() {
+  if (context != NULL) {
+    target.destroy();
+    eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+  }
+  if (display != NULL)
+    eglTerminate((EGLDisplay)display);
+  context = display = NULL;
+}
+
+#else
+
+bool HeadlessContext::create(unsigned int, unsigned int) {
+  std::cout << "ERROR::HEADLESS::NOT_BUILT_WITH_EGL" << std::endl;
+  return false;
+}
+
+void HeadlessContext::destroy() {}
+
+#endif
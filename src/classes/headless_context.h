@@ -0,0 +1,34 @@
+#ifndef HEADLESS_CONTEXT_H
+#define HEADLESS_CONTEXT_H
+
+#include <glad/glad.h>
+
+#include "framebuffer.h"
+
+/*
+ A GL 3.3 core context without a window or a display server, for render nodes and CI. It comes from EGL on Mesa's
+ surfaceless platform (EGL_MESA_platform_surfaceless), which runs on llvmpipe when there is no GPU, and falls back to
+ the default EGL display with EGL_KHR_surfaceless_context. There is no default framebuffer, so frames are drawn into
+ target, a Framebuffer of the requested size.
+ Only built where CMake found EGL (HAVE_EGL), elsewhere create() reports an error and fails.
+*/
+class HeadlessContext {
+public:
+  Framebuffer target;
+
+  HeadlessContext();
+
+  // creates the context, makes it current on this thread, loads GL through glad and GLExtensions and binds target
+  bool create(unsigned int width, unsigned int height);
+
+  void destroy();
+
+private:
+  void *display; // EGLDisplay
+  void *context; // EGLContext
+
+  HeadlessContext(const HeadlessContext &);
+  HeadlessContext &operator=(const HeadlessContext &);
+};
+
+#endif
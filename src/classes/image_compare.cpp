@@ -0,0 +1,149 @@
+#include <algorithm>
+#include <cstdlib>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "image_compare.h"
+
+// SSIM window and stabilizing constants, for 8 bit values (Wang et al. 2004)
+static const unsigned int SSIM_WINDOW = 8;
+static const unsigned int SSIM_STEP = 4;
+static const double SSIM_C1 = (0.01 * 255) * (0.01 * 255);
+static const double SSIM_C2 = (0.03 * 255) * (0.03 * 255);
+
+static inline unsigned int popcount16(unsigned int mask) {
+  unsigned int count = 0;
+  for (; mask != 0; mask &= mask - 1)
+    count++;
+  return count;
+}
+
+static void pixelDifferences(const unsigned char *a, const unsigned char *b, size_t pixels, unsigned int threshold, ImageComparison &result) {
+  unsigned char *out = result.perPixel.empty() ? NULL : &result.perPixel[0];
+  unsigned int maxDifference = 0;
+  size_t different = 0;
+  unsigned long long sum = 0;
+  size_t i = 0;
+
+#if defined(__SSE2__)
+  const __m128i lowByte = _mm_set1_epi32(0xff);
+  const __m128i limit = _mm_set1_epi8((char)std::min(threshold, 255u));
+  const __m128i zero = _mm_setzero_si128();
+  __m128i maxima = zero, sums = zero;
+  for (; i + 16 <= pixels; i += 16) {
+    __m128i packed[4];
+    for (int k = 0; k < 4; k++) {
+      __m128i x = _mm_loadu_si128((const __m128i *)(a + (i + k * 4) * 4));
+      __m128i y = _mm_loadu_si128((const __m128i *)(b + (i + k * 4) * 4));
+      // |x - y| per channel, then the largest channel into the low byte of each pixel
+      __m128i d = _mm_or_si128(_mm_subs_epu8(x, y), _mm_subs_epu8(y, x));
+      d = _mm_max_epu8(d, _mm_srli_epi32(d, 8));
+      d = _mm_max_epu8(d, _mm_srli_epi32(d, 16));
+      packed[k] = _mm_and_si128(d, lowByte);
+    }
+    __m128i d = _mm_packus_epi16(_mm_packs_epi32(packed[0], packed[1]), _mm_packs_epi32(packed[2], packed[3]));
+    _mm_storeu_si128((__m128i *)(out + i), d);
+
+    maxima = _mm_max_epu8(maxima, d);
+    sums = _mm_add_epi64(sums, _mm_sad_epu8(d, zero));
+    // unsigned d > limit exactly when the saturated difference is not zero
+    unsigned int within = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_subs_epu8(d, limit), zero));
+    different += 16 - popcount16(within);
+  }
+  unsigned char lanes[16];
+  _mm_storeu_si128((__m128i *)lanes, maxima);
+  for (int k = 0; k < 16; k++)
+    maxDifference = std::max(maxDifference, (unsigned int)lanes[k]);
+  unsigned long long halves[2];
+  _mm_storeu_si128((__m128i *)halves, sums);
+  sum = halves[0] + halves[1];
+#endif
+
+  for (; i < pixels; i++) {
+    unsigned int d = 0;
+    for (int c = 0; c < 4; c++)
+      d = std::max(d, (unsigned int)std::abs(a[i * 4 + c] - b[i * 4 + c]));
+    out[i] = (unsigned char)d;
+    maxDifference = std::max(maxDifference, d);
+    sum += d;
+    if (d > threshold)
+      different++;
+  }
+
+  result.maxDifference = maxDifference;
+  result.differentPixels = different;
+  result.meanDifference = pixels > 0 ? (double)sum / pixels : 0.0;
+}
+
+static void luma(const unsigned char *rgba, size_t pixels, std::vector<float> &out) {
+  out.resize(pixels);
+  for (size_t i = 0; i < pixels; i++)
+    out[i] = 0.299f * rgba[i * 4] + 0.587f * rgba[i * 4 + 1] + 0.114f * rgba[i * 4 + 2];
+}
+
+static double structuralSimilarity(const unsigned char *a, const unsigned char *b, unsigned int width, unsigned int height) {
+  std::vector<float> x, y;
+  luma(a, (size_t)width * height, x);
+  luma(b, (size_t)width * height, y);
+
+  // images smaller than a window are one window
+  unsigned int windowWidth = std::min(SSIM_WINDOW, width), windowHeight = std::min(SSIM_WINDOW, height);
+  double total = 0.0;
+  unsigned int windows = 0;
+  for (unsigned int top = 0; top + windowHeight <= height; top += SSIM_STEP) {
+    for (unsigned int left = 0; left + windowWidth <= width; left += SSIM_STEP) {
+      double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumYY = 0.0, sumXY = 0.0;
+      for (unsigned int row = top; row < top + windowHeight; row++) {
+        const float *px = &x[(size_t)row * width + left], *py = &y[(size_t)row * width + left];
+        for (unsigned int col = 0; col < windowWidth; col++) {
+          sumX += px[col];
+          sumY += py[col];
+          sumXX += px[col] * px[col];
+          sumYY += py[col] * py[col];
+          sumXY += px[col] * py[col];
+        }
+      }
+      double n = windowWidth * windowHeight;
+      double meanX = sumX / n, meanY = sumY / n;
+      double varianceX = sumXX / n - meanX * meanX, varianceY = sumYY / n - meanY * meanY, covariance = sumXY / n - meanX * meanY;
+      total += ((2.0 * meanX * meanY + SSIM_C1) * (2.0 * covariance + SSIM_C2)) / ((meanX * meanX + meanY * meanY + SSIM_C1) * (varianceX + varianceY + SSIM_C2));
+      windows++;
+    }
+  }
+  return windows > 0 ? total / windows : 1.0;
+}
+
+ImageComparison compareImages(const unsigned char *actual, const unsigned char *expected, unsigned int width, unsigned int height, const ImageTolerance &tolerance) {
+  ImageComparison result;
+  size_t pixels = (size_t)width * height;
+  result.perPixel.resize(pixels);
+  pixelDifferences(actual, expected, pixels, tolerance.threshold, result);
+  result.ssim = structuralSimilarity(actual, expected, width, height);
+  result.passed = result.differentPixels <= tolerance.maxDifferentFraction * pixels && result.ssim >= tolerance.minSSIM;
+  return result;
+}
+
+void differenceHeatmap(const unsigned char *expected, const ImageComparison &comparison, unsigned int width, unsigned int height, unsigned int threshold,
+                       std::vector<unsigned char> &heatmap) {
+  size_t pixels = (size_t)width * height;
+  heatmap.resize(pixels * 4);
+  for (size_t i = 0; i < pixels; i++) {
+    const unsigned char *source = expected + i * 4;
+    unsigned char *target = &heatmap[i * 4];
+    unsigned int d = comparison.perPixel[i];
+    if (d <= threshold) {
+      // within tolerance: the reference, dark and gray, so the differences stand out
+      unsigned char gray = (unsigned char)((source[0] * 77 + source[1] * 150 + source[2] * 29) >> 10);
+      target[0] = target[1] = target[2] = gray;
+    } else {
+      // blue for barely over the threshold, through red to yellow for differences of 128 and more
+      float t = std::min(1.0f, (float)(d - threshold) / (float)std::max(1u, 128u - std::min(threshold, 127u)));
+      target[0] = (unsigned char)(255.0f * std::min(1.0f, 2.0f * t));
+      target[1] = (unsigned char)(255.0f * std::max(0.0f, 2.0f * t - 1.0f));
+      target[2] = (unsigned char)(255.0f * std::max(0.0f, 1.0f - 2.0f * t));
+    }
+    target[3] = 255;
+  }
+}
@@ -0,0 +1,35 @@
+#ifndef IMAGE_COMPARE_H
+#define IMAGE_COMPARE_H
+
+#include <cstddef>
+#include <vector>
+
+// how far a render may drift from its reference: driver and GPU differences in filtering and rasterization, not bugs
+struct ImageTolerance {
+  unsigned int threshold;      // a pixel differs when one of its channels is off by more than this
+  double maxDifferentFraction; // of the pixels that may differ
+  double minSSIM;              // lowest acceptable structural similarity
+};
+
+struct ImageComparison {
+  unsigned int maxDifference; // largest channel difference of any pixel
+  size_t differentPixels;     // pixels over the threshold
+  double meanDifference;      // of the per pixel differences
+  double ssim;                // mean SSIM of the luma over 8x8 windows, 1 for identical images
+  bool passed;
+
+  std::vector<unsigned char> perPixel; // largest channel difference of each pixel, for the heatmap
+};
+
+/*
+ Compares two RGBA8 images of the same size. The per pixel pass takes 16 pixels per step with SSE2 where the compiler
+ targets it. Exact differences say whether anything changed, SSIM whether it changed in a way anyone would see: a
+ shifted edge or a different filter costs many pixels but little similarity, a missing object costs both.
+*/
+ImageComparison compareImages(const unsigned char *actual, const unsigned char *expected, unsigned int width, unsigned int height, const ImageTolerance &tolerance);
+
+// where the images differ, hot colors over the darkened reference, RGBA8 like the inputs
+void differenceHeatmap(const unsigned char *expected, const ImageComparison &comparison, unsigned int width, unsigned int height, unsigned int threshold,
+                       std::vector<unsigned char> &heatmap);
+
+#endif
@@ -0,0 +1,340 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "image_writer.h"
+
+// deflate's match limits
+static const unsigned int WINDOW_SIZE = 32768;
+static const unsigned int MIN_MATCH = 3;
+static const unsigned int MAX_MATCH = 258;
+
+// hash chain match finder: longer chains find longer matches, slower
+static const unsigned int HASH_BITS = 15;
+static const unsigned int MAX_CHAIN = 16;
+
+static const unsigned short LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const unsigned char LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const unsigned short DISTANCE_BASE[30] = {1,   2,   3,   4,   5,   7,    9,    13,   17,   25,   33,   49,   65,    97,    129,
+                                                 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static const unsigned char DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// deflate packs its bits least significant first
+class BitWriter {
+public:
+  BitWriter(std::vector<unsigned char> &out) : out(out), bits(0), count(0) {}
+
+  void put(uint32_t value, unsigned int length) {
+    bits |= (uint64_t)value << count;
+    count += length;
+    while (count >= 8) {
+      out.push_back((unsigned char)bits);
+      bits >>= 8;
+      count -= 8;
+    }
+  }
+
+  void flush() {
+    if (count > 0)
+      out.push_back((unsigned char)bits);
+    bits = 0;
+    count = 0;
+  }
+
+private:
+  std::vector<unsigned char> &out;
+  uint64_t bits;
+  unsigned int count;
+};
+
+// Huffman codes are the exception, they go most significant bit first
+static uint32_t reverseBits(uint32_t code, unsigned int length) {
+  uint32_t reversed = 0;
+  for (unsigned int i = 0; i < length; i++, code >>= 1)
+    reversed = (reversed << 1) | (code & 1);
+  return reversed;
+}
+
+// the fixed literal/length and distance codes of RFC 1951 3.2.6, already reversed
+struct FixedCodes {
+  uint16_t literal[288];
+  uint8_t literalLength[288];
+  uint8_t distance[30];
+
+  FixedCodes() {
+    for (unsigned int symbol = 0; symbol < 288; symbol++) {
+      unsigned int code, length;
+      if (symbol < 144)
+        code = 0x30 + symbol, length = 8;
+      else if (symbol < 256)
+        code = 0x190 + symbol - 144, length = 9;
+      else if (symbol < 280)
+        code = symbol - 256, length = 7;
+      else
+        code = 0xc0 + symbol - 280, length = 8;
+      literal[symbol] = (uint16_t)reverseBits(code, length);
+      literalLength[symbol] = (uint8_t)length;
+    }
+    for (unsigned int symbol = 0; symbol < 30; symbol++)
+      distance[symbol] = (uint8_t)reverseBits(symbol, 5);
+  }
+};
+
+static const FixedCodes FIXED_CODES;
+
+static void putLiteral(BitWriter &writer, unsigned int symbol) { writer.put(FIXED_CODES.literal[symbol], FIXED_CODES.literalLength[symbol]); }
+
+static void putMatch(BitWriter &writer, unsigned int length, unsigned int distance) {
+  unsigned int code = 0;
+  while (code < 28 && LENGTH_BASE[code + 1] <= length)
+    code++;
+  putLiteral(writer, 257 + code);
+  writer.put(length - LENGTH_BASE[code], LENGTH_EXTRA[code]);
+
+  code = 0;
+  while (code < 29 && DISTANCE_BASE[code + 1] <= distance)
+    code++;
+  writer.put(FIXED_CODES.distance[code], 5);
+  writer.put(distance - DISTANCE_BASE[code], DISTANCE_EXTRA[code]);
+}
+
+static inline uint32_t hash3(const unsigned char *p) { return ((p[0] << 16 | p[1] << 8 | p[2]) * 2654435761u) >> (32 - HASH_BITS); }
+
+// one final block with the fixed codes, matches found greedily
+static void deflate(const unsigned char *data, size_t size, std::vector<unsigned char> &out) {
+  BitWriter writer(out);
+  writer.put(1, 1); // BFINAL
+  writer.put(1, 2); // BTYPE fixed Huffman
+
+  std::vector<int32_t> head((size_t)1 << HASH_BITS, -1);
+  std::vector<int32_t> previous(WINDOW_SIZE, -1);
+  size_t i = 0;
+  while (i < size) {
+    unsigned int bestLength = 0, bestDistance = 0;
+    if (i + MIN_MATCH <= size) {
+      uint32_t h = hash3(data + i);
+      unsigned int maxLength = (unsigned int)(size - i < MAX_MATCH ? size - i : MAX_MATCH);
+      int32_t candidate = head[h];
+      for (unsigned int chain = 0; chain < MAX_CHAIN && candidate >= 0 && i - candidate <= WINDOW_SIZE; chain++) {
+        const unsigned char *a = data + candidate, *b = data + i;
+        if (a[bestLength] == b[bestLength]) {
+          unsigned int length = 0;
+          while (length < maxLength && a[length] == b[length])
+            length++;
+          if (length > bestLength) {
+            bestLength = length;
+            bestDistance = (unsigned int)(i - candidate);
+            if (length == maxLength)
+              break;
+          }
+        }
+        candidate = previous[candidate & (WINDOW_SIZE - 1)];
+      }
+      previous[i & (WINDOW_SIZE - 1)] = head[h];
+      head[h] = (int32_t)i;
+    }
+
+    if (bestLength >= MIN_MATCH) {
+      putMatch(writer, bestLength, bestDistance);
+      // the matched bytes are found by later matches too
+      size_t end = i + bestLength;
+      for (i++; i < end; i++) {
+        if (i + MIN_MATCH <= size) {
+          uint32_t h = hash3(data + i);
+          previous[i & (WINDOW_SIZE - 1)] = head[h];
+          head[h] = (int32_t)i;
+        }
+      }
+    } else {
+      putLiteral(writer, data[i]);
+      i++;
+    }
+  }
+  putLiteral(writer, 256); // end of block
+  writer.flush();
+}
+
+static uint32_t adler32(const unsigned char *data, size_t size) {
+  uint32_t a = 1, b = 0;
+  while (size > 0) {
+    // the largest run that cannot overflow before the modulo
+    size_t run = size < 5552 ? size : 5552;
+    size -= run;
+    while (run-- > 0) {
+      a += *data++;
+      b += a;
+    }
+    a %= 65521;
+    b %= 65521;
+  }
+  return b << 16 | a;
+}
+
+struct CRCTable {
+  uint32_t entries[256];
+
+  CRCTable() {
+    for (uint32_t n = 0; n < 256; n++) {
+      uint32_t c = n;
+      for (int k = 0; k < 8; k++)
+        c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+      entries[n] = c;
+    }
+  }
+};
+
+static const CRCTable CRC_TABLE;
+
+static uint32_t crc32(const unsigned char *data, size_t size, uint32_t crc = 0) {
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++)
+    crc = CRC_TABLE.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+  return ~crc;
+}
+
+static void putBigEndian(std::vector<unsigned char> &out, uint32_t value) {
+  out.push_back((unsigned char)(value >> 24));
+  out.push_back((unsigned char)(value >> 16));
+  out.push_back((unsigned char)(value >> 8));
+  out.push_back((unsigned char)value);
+}
+
+static void putChunk(std::vector<unsigned char> &out, const char *type, const unsigned char *data, size_t size) {
+  putBigEndian(out, (uint32_t)size);
+  size_t start = out.size();
+  out.insert(out.end(), type, type + 4);
+  out.insert(out.end(), data, data + size);
+  putBigEndian(out, crc32(&out[start], size + 4));
+}
+
+static inline unsigned char paeth(int a, int b, int c) {
+  int p = a + b - c, pa = abs(p - a), pb = abs(p - b), pc = abs(p - c);
+  return (unsigned char)(pa <= pb && pa <= pc ? a : pb <= pc ? b : c);
+}
+
+void encodePNG(const unsigned char *rgba, unsigned int width, unsigned int height, std::vector<unsigned char> &out) {
+  // every row gets the filter whose output has the smallest sum of absolute values, the usual heuristic
+  size_t stride = (size_t)width * 4;
+  std::vector<unsigned char> filtered(height * (stride + 1));
+  std::vector<unsigned char> candidate(stride);
+  std::vector<unsigned char> zeroRow(stride, 0);
+  for (unsigned int y = 0; y < height; y++) {
+    const unsigned char *row = rgba + y * stride, *above = y > 0 ? row - stride : &zeroRow[0];
+    unsigned char *target = &filtered[y * (stride + 1)];
+    unsigned int bestCost = ~0u;
+    for (unsigned char filter = 0; filter < 5; filter++) {
+      unsigned int cost = 0;
+      for (size_t x = 0; x < stride; x++) {
+        int left = x >= 4 ? row[x - 4] : 0, up = above[x], upLeft = x >= 4 ? above[x - 4] : 0;
+        unsigned char predicted = filter == 0 ? 0 : filter == 1 ? left : filter == 2 ? up : filter == 3 ? (left + up) / 2 : paeth(left, up, upLeft);
+        candidate[x] = (unsigned char)(row[x] - predicted);
+        cost += candidate[x] < 128 ? candidate[x] : 256 - candidate[x];
+      }
+      if (cost < bestCost) {
+        bestCost = cost;
+        target[0] = filter;
+        memcpy(target + 1, &candidate[0], stride);
+      }
+    }
+  }
+
+  std::vector<unsigned char> compressed;
+  compressed.reserve(filtered.size() / 2);
+  compressed.push_back(0x78); // zlib, 32K window
+  compressed.push_back(0x01);
+  deflate(&filtered[0], filtered.size(), compressed);
+  putBigEndian(compressed, adler32(&filtered[0], filtered.size()));
+
+  static const unsigned char SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+  out.assign(SIGNATURE, SIGNATURE + 8);
+  std::vector<unsigned char> header;
+  putBigEndian(header, width);
+  putBigEndian(header, height);
+  const unsigned char format[5] = {8, 6, 0, 0, 0}; // 8 bit RGBA, deflate, adaptive filters, not interlaced
+  header.insert(header.end(), format, format + 5);
+  putChunk(out, "IHDR", &header[0], header.size());
+  putChunk(out, "IDAT", &compressed[0], compressed.size());
+  putChunk(out, "IEND", NULL, 0);
+}
+
+void encodeQOI(const unsigned char *rgba, unsigned int width, unsigned int height, std::vector<unsigned char> &out) {
+  out.clear();
+  out.reserve((size_t)width * height + 22);
+  const unsigned char magic[4] = {'q', 'o', 'i', 'f'};
+  out.insert(out.end(), magic, magic + 4);
+  putBigEndian(out, width);
+  putBigEndian(out, height);
+  out.push_back(4); // RGBA
+  out.push_back(0); // sRGB with linear alpha
+
+  unsigned char seen[64][4];
+  memset(seen, 0, sizeof(seen));
+  unsigned char previous[4] = {0, 0, 0, 255};
+  unsigned int run = 0;
+  size_t count = (size_t)width * height;
+  for (size_t i = 0; i < count; i++) {
+    const unsigned char *pixel = rgba + i * 4;
+    if (memcmp(pixel, previous, 4) == 0) {
+      run++;
+      if (run == 62 || i + 1 == count) {
+        out.push_back((unsigned char)(0xc0 | (run - 1)));
+        run = 0;
+      }
+      continue;
+    }
+    if (run > 0) {
+      out.push_back((unsigned char)(0xc0 | (run - 1)));
+      run = 0;
+    }
+
+    unsigned int index = (pixel[0] * 3 + pixel[1] * 5 + pixel[2] * 7 + pixel[3] * 11) % 64;
+    if (memcmp(seen[index], pixel, 4) == 0) {
+      out.push_back((unsigned char)index);
+    } else {
+      memcpy(seen[index], pixel, 4);
+      if (pixel[3] == previous[3]) {
+        signed char dr = (signed char)(pixel[0] - previous[0]), dg = (signed char)(pixel[1] - previous[1]), db = (signed char)(pixel[2] - previous[2]);
+        signed char drg = (signed char)(dr - dg), dbg = (signed char)(db - dg);
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          out.push_back((unsigned char)(0x40 | (dr + 2) << 4 | (dg + 2) << 2 | (db + 2)));
+        } else if (dg >= -32 && dg <= 31 && drg >= -8 && drg <= 7 && dbg >= -8 && dbg <= 7) {
+          out.push_back((unsigned char)(0x80 | (dg + 32)));
+          out.push_back((unsigned char)((drg + 8) << 4 | (dbg + 8)));
+        } else {
+          out.push_back(0xfe);
+          out.insert(out.end(), pixel, pixel + 3);
+        }
+      } else {
+        out.push_back(0xff);
+        out.insert(out.end(), pixel, pixel + 4);
+      }
+    }
+    memcpy(previous, pixel, 4);
+  }
+  const unsigned char end[8] = {0, 0, 0, 0, 0, 0, 0, 1};
+  out.insert(out.end(), end, end + 8);
+}
+
+static bool writeFile(const char *path, const std::vector<unsigned char> &data) {
+  FILE *file = fopen(path, "wb");
+  bool written = file != NULL && fwrite(&data[0], 1, data.size(), file) == data.size();
+  if (file != NULL && fclose(file) != 0)
+    written = false;
+  if (!written)
+    std::cout << "ERROR::IMAGE::NOT_WRITTEN " << path << std::endl;
+  return written;
+}
+
+bool writePNG(const char *path, const unsigned char *rgba, unsigned int width, unsigned int height) {
+  std::vector<unsigned char> png;
+  encodePNG(rgba, width, height, png);
+  return writeFile(path, png);
+}
+
+bool writeQOI(const char *path, const unsigned char *rgba, unsigned int width, unsigned int height) {
+  std::vector<unsigned char> qoi;
+  encodeQOI(rgba, width, height, qoi);
+  return writeFile(path, qoi);
+}
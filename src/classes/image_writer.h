@@ -0,0 +1,19 @@
+#ifndef IMAGE_WRITER_H
+#define IMAGE_WRITER_H
+
+#include <vector>
+
+/*
+ Encoders for RGBA8 images, rows tightly packed and top row first. stb_image only reads, these write.
+ PNG picks a filter per row and compresses with deflate's fixed Huffman codes over a hash chain match finder:
+ not as small as zlib's best, but a fraction of the size of the raw pixels, and fast enough to keep up with a
+ capture stream. QOI (qoiformat.org) is lossless too, larger than PNG and several times faster to write.
+*/
+void encodePNG(const unsigned char *rgba, unsigned int width, unsigned int height, std::vector<unsigned char> &out);
+void encodeQOI(const unsigned char *rgba, unsigned int width, unsigned int height, std::vector<unsigned char> &out);
+
+// encode and write to path, false when the file could not be written
+bool writePNG(const char *path, const unsigned char *rgba, unsigned int width, unsigned int height);
+bool writeQOI(const char *path, const unsigned char *rgba, unsigned int width, unsigned int height);
+
+#endif
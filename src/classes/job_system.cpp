@@ -0,0 +1,179 @@
+#include "job_system.h"
+
+// which system and worker the current thread belongs to, so run() knows which deque to push to
+static thread_local const JobSystem *currentSystem = NULL;
+static thread_local unsigned int currentIndex = 0;
+
+// yields before an idle thread goes to sleep, the next job of a frame is usually only microseconds away
+static const int IDLE_SPINS = 64;
+
+JobSystem::JobSystem(unsigned int threadCount) : queued(0), sleeping(0), stopping(false) {
+  if (threadCount == 0)
+    threadCount = std::thread::hardware_concurrency();
+  if (threadCount == 0)
+    threadCount = 1;
+
+  for (unsigned int i = 0; i < threadCount; i++)
+    workers.push_back(new Worker(0x9e3779b9u * (i + 1)));
+
+  currentSystem = this;
+  currentIndex = 0;
+  for (unsigned int i = 1; i < threadCount; i++)
+    threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+JobSystem::~JobSystem() {
+  {
+    std::lock_guard<std::mutex> lock(sleepMutex);
+    stopping = true;
+  }
+  wakeUp.notify_all();
+  for (size_t i = 0; i < threads.size(); i++)
+    threads[i].join();
+
+  for (size_t i = 0; i < workers.size(); i++)
+    delete workers[i];
+  if (currentSystem == this)
+    currentSystem = NULL;
+}
+
+JobSystem::Worker *JobSystem::currentWorker() { return currentSystem == this ? workers[currentIndex] : NULL; }
+
+void JobSystem::run(JobFunction function, const void *data, uint32_t begin, uint32_t end, uint32_t grain, JobCounter &counter) {
+  counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+  // a thread outside the system, a full deque, or a next ring slot whose job is still queued or running: the job runs
+  // right away on this thread from the stack. Only a job that will be pushed claims a slot
+  Worker *self = currentWorker();
+  Job *job = NULL;
+  if (self != NULL) {
+    Job &slot = self->jobs[self->nextJob & (JOBS_PER_THREAD - 1)];
+    if (!self->deque.full() && !slot.inFlight.load(std::memory_order_acquire)) {
+      job = &slot;
+      self->nextJob++;
+    } else {
+      self = NULL;
+    }
+  }
+
+  Job inlineJob;
+  if (job == NULL)
+    job = &inlineJob;
+  job->function = function;
+  job->data = data;
+  job->begin = begin;
+  job->end = end;
+  job->grain = grain;
+  job->counter = &counter;
+
+  if (self != NULL)
+    job->inFlight.store(true, std::memory_order_relaxed); // published by the push
+  if (self == NULL || !self->deque.push(job)) {
+    job->inFlight.store(false, std::memory_order_relaxed);
+    job->function(*this, *job);
+    counter.pending.fetch_sub(1, std::memory_order_release);
+    return;
+  }
+
+  queued.fetch_add(1, std::memory_order_seq_cst);
+  // a sleeper that has not started waiting yet still sees queued, so the notify can only be missed by a thread that does not need it
+  if (sleeping.load(std::memory_order_seq_cst) > 0) {
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    wakeUp.notify_one();
+  }
+}
+
+Job *JobSystem::steal(Worker &self) {
+  unsigned int count = (unsigned int)workers.size();
+  if (count < 2)
+    return NULL;
+
+  // start at a random victim, so thieves do not all line up behind the same deque
+  self.random ^= self.random << 13;
+  self.random ^= self.random >> 17;
+  self.random ^= self.random << 5;
+  unsigned int first = self.random % count;
+  for (unsigned int i = 0; i < count; i++) {
+    Worker &victim = *workers[(first + i) % count];
+    if (&victim == &self)
+      continue;
+    Job *job = victim.deque.steal();
+    if (job != NULL) {
+      self.stolen.fetch_add(1, std::memory_order_relaxed);
+      return job;
+    }
+  }
+  return NULL;
+}
+
+bool JobSystem::execute(Worker &self) {
+  Job *job = self.deque.pop();
+  if (job == NULL)
+    job = steal(self);
+  if (job == NULL)
+    return false;
+
+  queued.fetch_sub(1, std::memory_order_relaxed);
+  JobCounter *counter = job->counter;
+  job->function(*this, *job);
+  // hands the slot back to the thread that queued it
+  job->inFlight.store(false, std::memory_order_release);
+  self.executed.fetch_add(1, std::memory_order_relaxed);
+  // the waiter may return and destroy the counter right after this
+  counter->pending.fetch_sub(1, std::memory_order_release);
+  return true;
+}
+
+void JobSystem::wait(JobCounter &counter) {
+  Worker *self = currentWorker();
+  while (counter.pending.load(std::memory_order_acquire) > 0) {
+    if (self == NULL || !execute(*self))
+      std::this_thread::yield();
+  }
+}
+
+void JobSystem::workerLoop(unsigned int index) {
+  currentSystem = this;
+  currentIndex = index;
+  Worker &self = *workers[index];
+
+  while (!stopping.load(std::memory_order_relaxed)) {
+    if (execute(self))
+      continue;
+
+    bool found = false;
+    for (int spin = 0; spin < IDLE_SPINS && !found; spin++) {
+      std::this_thread::yield();
+      found = queued.load(std::memory_order_relaxed) > 0;
+    }
+    if (found)
+      continue;
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleeping.fetch_add(1, std::memory_order_seq_cst);
+    while (queued.load(std::memory_order_seq_cst) <= 0 && !stopping)
+      wakeUp.wait(lock);
+    sleeping.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+uint64_t JobSystem::executedJobs() const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < workers.size(); i++)
+    total += workers[i]->executed.load(std::memory_order_relaxed);
+  return total;
+}
+
+uint64_t JobSystem::stolenJobs() const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < workers.size(); i++)
+    total += workers[i]->stolen.load(std::memory_order_relaxed);
+  return total;
+}
+
+void JobSystem::resetStats() {
+  for (size_t i = 0; i < workers.size(); i++) {
+    workers[i]->executed.store(0, std::memory_order_relaxed);
+    workers[i]->stolen.store(0, std::memory_order_relaxed);
+  }
+}
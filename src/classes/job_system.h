@@ -0,0 +1,146 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "work_stealing_deque.hpp"
+
+class JobSystem;
+struct Job;
+
+typedef void (*JobFunction)(JobSystem &jobs, const Job &job);
+
+// fork/join: every job run() against a counter adds one, finishing it takes one away, wait() returns at zero
+class JobCounter {
+public:
+  JobCounter() : pending(0) {}
+
+  bool done() const { return pending.load(std::memory_order_acquire) == 0; }
+
+private:
+  friend class JobSystem;
+  std::atomic<int> pending;
+
+  JobCounter(const JobCounter &);
+  JobCounter &operator=(const JobCounter &);
+};
+
+struct Job {
+  JobFunction function;
+  const void *data;
+  uint32_t begin, end, grain; // the index range of a parallelFor piece
+  JobCounter *counter;
+  std::atomic<bool> inFlight; // a ring slot between being queued and its job finishing, run() skips it until then
+
+  Job() : inFlight(false) {}
+};
+
+/*
+ Work-stealing job scheduler. Every thread, the one that created the system included, owns a deque of jobs: it pushes
+ and pops its own at one end, idle threads steal from the other end of someone else's. The creating thread only works
+ while it is inside wait() or parallelFor(), so GL calls stay on it and nowhere else.
+ Jobs live in a ring of JOBS_PER_THREAD slots per thread. A slot is only reused once its job has finished; when the
+ next one is still in flight, or the deque is full, run() executes the job right away instead of queueing it.
+ run() and wait() may be called from the creating thread and from inside jobs.
+*/
+class JobSystem {
+public:
+  static const unsigned int JOBS_PER_THREAD = 4096;
+
+  // threads including the calling one, 0 means one per hardware thread
+  JobSystem(unsigned int threadCount = 0);
+  ~JobSystem();
+
+  unsigned int threadCount() const { return (unsigned int)workers.size(); }
+
+  void run(JobFunction function, const void *data, uint32_t begin, uint32_t end, uint32_t grain, JobCounter &counter);
+
+  // runs function() as a job, function has to stay alive until the counter is waited on
+  template <typename Function> void run(const Function &function, JobCounter &counter) { run(&JobSystem::invoke<Function>, &function, 0, 0, 0, counter); }
+
+  // helps with other jobs until the counter drops to zero
+  void wait(JobCounter &counter);
+
+  /*
+   Calls function(begin, end) over pieces of [0, count) of at most grain indices and returns when all are done. The
+   range is halved recursively: the calling thread keeps the lower half and leaves the upper half for a thief, so the
+   pieces spread out in a logarithmic number of steps and neighbouring indices stay on the same thread.
+  */
+  template <typename Function> void parallelFor(uint32_t count, uint32_t grain, const Function &function);
+
+  // jobs run, and how many of them on a thread other than the one that queued them, since resetStats()
+  uint64_t executedJobs() const;
+  uint64_t stolenJobs() const;
+  void resetStats();
+
+private:
+  struct Worker {
+    WorkStealingDeque<Job *, JOBS_PER_THREAD> deque;
+    Job jobs[JOBS_PER_THREAD];
+    uint32_t nextJob;
+    uint32_t random; // xorshift state for picking victims
+    std::atomic<uint64_t> executed, stolen;
+
+    Worker(uint32_t seed) : nextJob(0), random(seed), executed(0), stolen(0) {}
+  };
+
+  std::vector<Worker *> workers; // workers[0] belongs to the creating thread
+  std::vector<std::thread> threads;
+
+  // idle threads sleep until a job is queued
+  std::atomic<int> queued;
+  std::atomic<int> sleeping;
+  std::atomic<bool> stopping;
+  std::mutex sleepMutex;
+  std::condition_variable wakeUp;
+
+  Worker *currentWorker();
+  Job *steal(Worker &self);
+  bool execute(Worker &self);
+  void workerLoop(unsigned int index);
+
+  template <typename Function> static void invoke(JobSystem &jobs, const Job &job) { (*(const Function *)job.data)(); }
+  template <typename Function> static void forRange(JobSystem &jobs, const Job &job);
+
+  JobSystem(const JobSystem &);
+  JobSystem &operator=(const JobSystem &);
+};
+
+template <typename Function> void JobSystem::forRange(JobSystem &jobs, const Job &job) {
+  // copied out once, the slot stays ours until this returns but locals keep the loop out of shared memory
+  const void *data = job.data;
+  uint32_t begin = job.begin, end = job.end, grain = job.grain;
+  JobCounter &counter = *job.counter;
+
+  while (end - begin > grain) {
+    uint32_t middle = begin + (end - begin) / 2;
+    jobs.run(&JobSystem::forRange<Function>, data, middle, end, grain, counter);
+    end = middle;
+  }
+  (*(const Function *)data)(begin, end);
+}
+
+template <typename Function> void JobSystem::parallelFor(uint32_t count, uint32_t grain, const Function &function) {
+  if (count == 0)
+    return;
+
+  JobCounter counter;
+  Job root;
+  root.function = &JobSystem::forRange<Function>;
+  root.data = &function;
+  root.begin = 0;
+  root.end = count;
+  root.grain = grain > 0 ? grain : 1;
+  root.counter = &counter;
+
+  // the first piece runs right here, only what it splits off goes through the deques
+  forRange<Function>(*this, root);
+  wait(counter);
+}
+
+#endif
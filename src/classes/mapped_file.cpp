@@ -0,0 +1,65 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "mapped_file.h"
+
+bool MappedFile::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    ::close(fd);
+    return false;
+  }
+
+  size = (size_t)info.st_size;
+  if (size > 0) {
+    mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      mapping = NULL;
+      size = 0;
+      ::close(fd);
+      return false;
+    }
+    data = (const unsigned char *)mapping;
+  }
+
+  // the mapping keeps the file alive on its own
+  ::close(fd);
+  opened = true;
+  return true;
+}
+
+void MappedFile::close() {
+  if (mapping)
+    munmap(mapping, size);
+  mapping = NULL;
+  data = NULL;
+  size = 0;
+  opened = false;
+}
+
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed) {
+  const unsigned char *bytes = (const unsigned char *)data;
+  uint64_t hash = seed;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+
+bool fileStat(const char *path, int64_t &mtime, uint64_t &size) {
+  struct stat info;
+  if (stat(path, &info) != 0)
+    return false;
+  mtime = (int64_t)info.st_mtime;
+  size = (uint64_t)info.st_size;
+  return true;
+}
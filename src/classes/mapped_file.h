@@ -0,0 +1,36 @@
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+
+// A read-only memory mapping of a whole file. The pages are shared with the OS file cache, nothing is copied until touched
+class MappedFile {
+public:
+  const unsigned char *data;
+  size_t size;
+
+  MappedFile() : data(NULL), size(0), mapping(NULL), opened(false) {}
+  ~MappedFile() { close(); }
+
+  // false if the file cannot be opened or mapped. An empty file opens fine with data == NULL
+  bool open(const char *path);
+  void close();
+
+  bool isOpen() const { return opened; }
+
+private:
+  void *mapping;
+  bool opened;
+
+  MappedFile(const MappedFile &);
+  MappedFile &operator=(const MappedFile &);
+};
+
+// FNV-1a, 64 bit
+uint64_t hashBytes(const void *data, size_t size, uint64_t seed = 14695981039346656037ull);
+
+// modification time in seconds and size of a file, false if it does not exist
+bool fileStat(const char *path, int64_t &mtime, uint64_t &size);
+
+#endif
@@ -0,0 +1,238 @@
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+
+#include "mesh_builder.h"
+
+std::vector<uint16_t> IndexedMesh::shortIndices() const {
+  std::vector<uint16_t> result(indices.size());
+  for (size_t i = 0; i < indices.size(); i++)
+    result[i] = (uint16_t)indices[i];
+  return result;
+}
+
+// FNV-1a over the raw bytes of one vertex
+static uint32_t hashVertex(const float *vertex, unsigned int floatsPerVertex) {
+  const unsigned char *bytes = (const unsigned char *)vertex;
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < floatsPerVertex * sizeof(float); i++) {
+    hash ^= bytes[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+IndexedMesh weldVertices(const float *vertices, size_t vertexCount, unsigned int floatsPerVertex) {
+  IndexedMesh mesh;
+  mesh.floatsPerVertex = floatsPerVertex;
+  mesh.indices.resize(vertexCount);
+
+  // open addressing table holding (unique index + 1), 0 marks an empty slot
+  size_t tableSize = 1;
+  while (tableSize < vertexCount * 2)
+    tableSize <<= 1;
+  std::vector<uint32_t> table(tableSize, 0);
+
+  size_t vertexSize = floatsPerVertex * sizeof(float);
+  for (size_t i = 0; i < vertexCount; i++) {
+    const float *vertex = vertices + i * floatsPerVertex;
+    size_t slot = hashVertex(vertex, floatsPerVertex) & (tableSize - 1);
+
+    while (table[slot] != 0 && memcmp(&mesh.vertices[(table[slot] - 1) * floatsPerVertex], vertex, vertexSize) != 0)
+      slot = (slot + 1) & (tableSize - 1);
+
+    if (table[slot] == 0) {
+      mesh.vertices.insert(mesh.vertices.end(), vertex, vertex + floatsPerVertex);
+      table[slot] = (uint32_t)mesh.vertexCount();
+    }
+    mesh.indices[i] = table[slot] - 1;
+  }
+
+  return mesh;
+}
+
+/*
+ Forsyth's algorithm greedily emits the triangle with the highest score, where a triangle scores
+ the sum of its vertices. A vertex scores high when it sits near the front of a simulated LRU cache
+ (it is cheap to reuse) and when few triangles still need it (finish it off so it can leave the cache).
+ See "Linear-Speed Vertex Cache Optimisation", Tom Forsyth, 2006.
+*/
+static const int FORSYTH_CACHE_SIZE = 32;
+static const float CACHE_DECAY_POWER = 1.5f;
+static const float LAST_TRI_SCORE = 0.75f;
+static const float VALENCE_BOOST_SCALE = 2.0f;
+static const float VALENCE_BOOST_POWER = 0.5f;
+
+static float vertexScore(int cachePosition, unsigned int remainingTriangles) {
+  if (remainingTriangles == 0)
+    return -1.0f;
+
+  float score = 0.0f;
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // the triangle that was just emitted, using its vertices again gains nothing on the next one
+      score = LAST_TRI_SCORE;
+    } else {
+      float scaler = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+      score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+    }
+  }
+
+  score += VALENCE_BOOST_SCALE * powf((float)remainingTriangles, -VALENCE_BOOST_POWER);
+  return score;
+}
+
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount) {
+  size_t triangleCount = indices.size() / 3;
+  if (triangleCount == 0)
+    return;
+
+  // per vertex triangle adjacency, in one flat array
+  std::vector<uint32_t> remaining(vertexCount, 0);
+  for (size_t i = 0; i < indices.size(); i++)
+    remaining[indices[i]]++;
+
+  std::vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+  for (size_t v = 0; v < vertexCount; v++)
+    adjacencyOffset[v + 1] = adjacencyOffset[v] + remaining[v];
+
+  std::vector<uint32_t> adjacency(indices.size());
+  std::vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+  for (size_t t = 0; t < triangleCount; t++) {
+    for (int k = 0; k < 3; k++)
+      adjacency[fill[indices[t * 3 + k]]++] = (uint32_t)t;
+  }
+
+  std::vector<int> cachePosition(vertexCount, -1);
+  std::vector<float> score(vertexCount);
+  for (size_t v = 0; v < vertexCount; v++)
+    score[v] = vertexScore(-1, remaining[v]);
+
+  std::vector<float> triangleScore(triangleCount);
+  std::vector<bool> emitted(triangleCount, false);
+  for (size_t t = 0; t < triangleCount; t++)
+    triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+
+  // cache holds FORSYTH_CACHE_SIZE entries, plus room for the 3 pushed in before the overflow is dropped
+  std::vector<int> cache, nextCache;
+  cache.reserve(FORSYTH_CACHE_SIZE + 3);
+  nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+
+  std::vector<uint32_t> output;
+  output.reserve(indices.size());
+
+  size_t scanCursor = 0;
+  long bestTriangle = -1;
+
+  while (output.size() < indices.size()) {
+    if (bestTriangle < 0) {
+      // nothing in the cache touches an open triangle, take the next open one in input order
+      while (emitted[scanCursor])
+        scanCursor++;
+      bestTriangle = (long)scanCursor;
+    }
+
+    const uint32_t *tri = &indices[bestTriangle * 3];
+    emitted[bestTriangle] = true;
+    output.insert(output.end(), tri, tri + 3);
+
+    // the emitted triangle no longer needs its vertices
+    for (int k = 0; k < 3; k++) {
+      uint32_t v = tri[k];
+      uint32_t *begin = &adjacency[adjacencyOffset[v]];
+      uint32_t *end = begin + remaining[v];
+      for (uint32_t *it = begin; it != end; it++) {
+        if (*it == (uint32_t)bestTriangle) {
+          *it = *(end - 1);
+          break;
+        }
+      }
+      remaining[v]--;
+    }
+
+    // move the triangle's vertices to the front of the LRU cache
+    nextCache.clear();
+    nextCache.push_back(tri[0]);
+    nextCache.push_back(tri[1]);
+    nextCache.push_back(tri[2]);
+    for (size_t i = 0; i < cache.size(); i++) {
+      int v = cache[i];
+      if (v != (int)tri[0] && v != (int)tri[1] && v != (int)tri[2])
+        nextCache.push_back(v);
+    }
+    cache.swap(nextCache);
+
+    // rescore everything that moved in the cache, including the ones that just fell out
+    for (size_t i = 0; i < cache.size(); i++) {
+      int v = cache[i];
+      cachePosition[v] = i < (size_t)FORSYTH_CACHE_SIZE ? (int)i : -1;
+      score[v] = vertexScore(cachePosition[v], remaining[v]);
+    }
+
+    bestTriangle = -1;
+    float bestScore = -1.0f;
+    for (size_t i = 0; i < cache.size(); i++) {
+      int v = cache[i];
+      for (uint32_t j = 0; j < remaining[v]; j++) {
+        uint32_t t = adjacency[adjacencyOffset[v] + j];
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+        if (triangleScore[t] > bestScore) {
+          bestScore = triangleScore[t];
+          bestTriangle = t;
+        }
+      }
+    }
+
+    if (cache.size() > (size_t)FORSYTH_CACHE_SIZE)
+      cache.resize(FORSYTH_CACHE_SIZE);
+  }
+
+  indices.swap(output);
+}
+
+float computeACMR(const std::vector<uint32_t> &indices, unsigned int cacheSize) {
+  if (indices.size() < 3)
+    return 0.0f;
+
+  // FIFO like most hardware caches: a hit does not refresh the entry
+  std::vector<uint32_t> fifo(cacheSize);
+  unsigned int filled = 0, head = 0;
+  size_t misses = 0;
+
+  for (size_t i = 0; i < indices.size(); i++) {
+    bool hit = false;
+    for (unsigned int j = 0; j < filled; j++) {
+      if (fifo[j] == indices[i]) {
+        hit = true;
+        break;
+      }
+    }
+
+    if (!hit) {
+      misses++;
+      fifo[head] = indices[i];
+      head = (head + 1) % cacheSize;
+      if (filled < cacheSize)
+        filled++;
+    }
+  }
+
+  return (float)misses / (float)(indices.size() / 3);
+}
+
+IndexedMesh buildIndexedMesh(const char *name, const float *vertices, size_t vertexCount, unsigned int floatsPerVertex) {
+  IndexedMesh mesh = weldVertices(vertices, vertexCount, floatsPerVertex);
+  float weldedACMR = computeACMR(mesh.indices);
+
+  optimizeVertexCache(mesh.indices, mesh.vertexCount());
+  float optimizedACMR = computeACMR(mesh.indices);
+
+  std::cout << "MESH::" << name << " VERTICES " << vertexCount << " -> " << mesh.vertexCount() << " INDICES " << mesh.indices.size() << " ("
+            << (mesh.fitsShortIndices() ? 16 : 32) << " bit)" << std::fixed << std::setprecision(3) << " ACMR " << weldedACMR << " -> " << optimizedACMR
+            << std::defaultfloat << std::endl;
+
+  return mesh;
+}
@@ -0,0 +1,38 @@
+#ifndef MESH_BUILDER_H
+#define MESH_BUILDER_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// An indexed triangle list with interleaved float vertices
+struct IndexedMesh {
+  std::vector<float> vertices;
+  std::vector<uint32_t> indices;
+  unsigned int floatsPerVertex;
+
+  size_t vertexCount() const { return floatsPerVertex ? vertices.size() / floatsPerVertex : 0; }
+
+  // 16 bit indices halve the index buffer, usable as long as every vertex can be addressed
+  bool fitsShortIndices() const { return vertexCount() <= 65536; }
+  GLenum indexType() const { return fitsShortIndices() ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT; }
+
+  // the index buffer narrowed to 16 bits, only valid when fitsShortIndices()
+  std::vector<uint16_t> shortIndices() const;
+};
+
+// merges bitwise identical vertices of an expanded triangle list (3 vertices per triangle) into unique vertices + indices
+IndexedMesh weldVertices(const float *vertices, size_t vertexCount, unsigned int floatsPerVertex);
+
+// reorders triangles so vertices get reused while they are still in the post-transform cache (Tom Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::vector<uint32_t> &indices, size_t vertexCount);
+
+// average cache miss ratio: transformed vertices per triangle with a FIFO cache of the given size. 3.0 is no reuse, 0.5 is the limit for regular grids
+float computeACMR(const std::vector<uint32_t> &indices, unsigned int cacheSize = 16);
+
+// weld + optimize, printing the vertex count and ACMR before and after
+IndexedMesh buildIndexedMesh(const char *name, const float *vertices, size_t vertexCount, unsigned int floatsPerVertex);
+
+#endif
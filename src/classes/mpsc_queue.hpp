@@ -0,0 +1,63 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/*
+ Lock-free, unbounded multi-producer single-consumer queue (Dmitry Vyukov's intrusive design).
+ Nodes carry their own link, so pushing never allocates: T needs a `std::atomic<T *> next` member
+ and a default constructor for the internal stub node.
+ push() may be called from any thread, pop() only from the consumer thread.
+*/
+template <typename T> class MPSCQueue {
+public:
+  MPSCQueue() : head(&stub), tail(&stub) { stub.next.store(NULL, std::memory_order_relaxed); }
+
+  void push(T *node) {
+    node->next.store(NULL, std::memory_order_relaxed);
+    T *previous = head.exchange(node, std::memory_order_acq_rel);
+    previous->next.store(node, std::memory_order_release);
+  }
+
+  // returns NULL when empty, or when a producer is halfway through a push (it shows up on the next call)
+  T *pop() {
+    T *first = tail;
+    T *next = first->next.load(std::memory_order_acquire);
+
+    if (first == &stub) {
+      if (next == NULL)
+        return NULL;
+      tail = next;
+      first = next;
+      next = next->next.load(std::memory_order_acquire);
+    }
+
+    if (next != NULL) {
+      tail = next;
+      return first;
+    }
+
+    if (first != head.load(std::memory_order_acquire))
+      return NULL;
+
+    // first is the last node, put the stub behind it so it can be handed out
+    push(&stub);
+    next = first->next.load(std::memory_order_acquire);
+    if (next != NULL) {
+      tail = next;
+      return first;
+    }
+    return NULL;
+  }
+
+private:
+  std::atomic<T *> head;
+  T *tail;
+  T stub;
+
+  MPSCQueue(const MPSCQueue &);
+  MPSCQueue &operator=(const MPSCQueue &);
+};
+
+#endif
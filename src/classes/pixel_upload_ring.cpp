@@ -0,0 +1,92 @@
+#include <glad/glad.h>
+
+#include "gl_extensions.h"
+#include "pixel_upload_ring.h"
+
+PixelUploadRing::PixelUploadRing(size_t slotSize, unsigned int slotCount, bool allowPersistent)
+    : slotSize(slotSize), slotCount(slotCount), next(0), persistentMemory(NULL) {
+  fences.resize(slotCount, (GLsync)0);
+
+  if (allowPersistent && GLExtensions::bufferStorage) {
+    buffers.resize(1);
+    glGenBuffers(1, &buffers[0]);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[0]);
+
+    GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    GLExtensions::BufferStorage(GL_PIXEL_UNPACK_BUFFER, slotSize * slotCount, NULL, flags);
+    persistentMemory = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, slotSize * slotCount, flags);
+  }
+
+  if (persistentMemory == NULL) {
+    if (!buffers.empty())
+      glDeleteBuffers(1, &buffers[0]);
+    buffers.resize(slotCount);
+    glGenBuffers(slotCount, &buffers[0]);
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+PixelUploadSlot PixelUploadRing::acquire(size_t size) {
+  PixelUploadSlot slot;
+  slot.index = next;
+  slot.size = size;
+  slot.memory = NULL;
+  slot.offset = NULL;
+  if (size > slotSize)
+    return slot;
+
+  if (persistent()) {
+    // wait until the GPU has consumed what was staged in this slot last time around
+    if (fences[slot.index]) {
+      while (glClientWaitSync(fences[slot.index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED) {
+      }
+      glDeleteSync(fences[slot.index]);
+      fences[slot.index] = (GLsync)0;
+    }
+
+    slot.memory = persistentMemory + slot.index * slotSize;
+    slot.offset = (const unsigned char *)(slot.index * slotSize);
+  } else {
+    // orphan: the old storage lives on until pending uploads from it are done, we get new storage right away
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[slot.index]);
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, NULL, GL_STREAM_DRAW);
+    slot.memory = (unsigned char *)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  }
+
+  next = (next + 1) % slotCount;
+  return slot;
+}
+
+void PixelUploadRing::beginUpload(const PixelUploadSlot &slot) {
+  if (persistent()) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[0]);
+  } else {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[slot.index]);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+  }
+}
+
+void PixelUploadRing::endUpload(const PixelUploadSlot &slot) {
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  if (persistent())
+    fences[slot.index] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void PixelUploadRing::destroy() {
+  for (size_t i = 0; i < fences.size(); i++) {
+    if (fences[i])
+      glDeleteSync(fences[i]);
+  }
+
+  if (persistent()) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffers[0]);
+    glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    persistentMemory = NULL;
+  }
+
+  glDeleteBuffers((GLsizei)buffers.size(), &buffers[0]);
+  buffers.clear();
+}
@@ -0,0 +1,58 @@
+#ifndef PIXEL_UPLOAD_RING_H
+#define PIXEL_UPLOAD_RING_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <vector>
+
+// Staging memory handed out by PixelUploadRing::acquire
+struct PixelUploadSlot {
+  unsigned char *memory;       // write the pixels here, NULL if the ring could not provide the space
+  const unsigned char *offset; // what to pass as the pixel pointer to glTexImage2D between beginUpload and endUpload
+  unsigned int index;
+  size_t size;
+};
+
+/*
+ Stages texture uploads through a ring of GL_PIXEL_UNPACK_BUFFERs, so glTexImage2D copies from buffer memory
+ the driver owns and can return before the transfer is done, instead of copying client memory synchronously.
+
+ With GL_ARB_buffer_storage one buffer is mapped persistently for the whole lifetime of the ring and each slot is
+ guarded by a fence, so a slot is only rewritten once the GPU finished reading it. Without it every acquire
+ orphans the slot's buffer and maps fresh storage, which lets the driver do the same bookkeeping.
+*/
+class PixelUploadRing {
+public:
+  // a 512x512 RGBA level, what the scene's largest textures need. Larger uploads are not staged, acquire() hands out
+  // no memory for them and they go straight from client memory
+  static const size_t DEFAULT_SLOT_SIZE = 1024 * 1024;
+
+  // allowPersistent = false forces the orphaning path even where buffer storage is available
+  PixelUploadRing(size_t slotSize = DEFAULT_SLOT_SIZE, unsigned int slotCount = 3, bool allowPersistent = true);
+
+  bool persistent() const { return persistentMemory != NULL; }
+
+  // GL thread only. Waits if the next slot is still being read by the GPU, memory is NULL when size is over the slot size.
+  // When persistent the memory can be filled from any thread until beginUpload
+  PixelUploadSlot acquire(size_t size);
+
+  // binds the slot's buffer to GL_PIXEL_UNPACK_BUFFER
+  void beginUpload(const PixelUploadSlot &slot);
+
+  // unbinds and fences the slot
+  void endUpload(const PixelUploadSlot &slot);
+
+  void destroy();
+
+private:
+  size_t slotSize;
+  unsigned int slotCount;
+  unsigned int next;
+
+  std::vector<unsigned int> buffers; // one per slot when orphaning, a single one when persistent
+  std::vector<GLsync> fences;
+  unsigned char *persistentMemory;
+};
+
+#endif
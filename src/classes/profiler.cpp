@@ -0,0 +1,159 @@
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "profiler.h"
+
+Profiler *Profiler::current = NULL;
+
+Profiler::Profiler(bool keepTrace)
+    : frameNumber(0), depth(0), gpuTimer(false), keepTrace(keepTrace), traceFull(false), lastFrameBegin(0), start(std::chrono::steady_clock::now()) {
+  // GL 3.3 has timestamp queries, but a driver may report a 0 bit counter when it cannot time anything
+  GLint bits = 0;
+  glGetQueryiv(GL_TIMESTAMP, GL_QUERY_COUNTER_BITS, &bits);
+  gpuTimer = bits > 0;
+
+  for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+    frames[i].number = 0;
+    frames[i].recorded = false;
+    frames[i].gpuToCpu = 0;
+    frames[i].scopes.reserve(MAX_SCOPES);
+    if (gpuTimer)
+      glGenQueries(MAX_SCOPES * 2, frames[i].queries);
+  }
+}
+
+uint64_t Profiler::now() const { return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(); }
+
+void Profiler::beginFrame() {
+  Frame &frame = frames[frameNumber % FRAMES_IN_FLIGHT];
+  // recorded FRAMES_IN_FLIGHT frames ago, its queries are done unless the GPU is that far behind
+  if (frame.recorded)
+    collect(frame);
+
+  frame.number = frameNumber;
+  frame.recorded = true;
+  frame.scopes.clear();
+  depth = 0;
+  if (gpuTimer) {
+    // the GPU clock has its own origin, line it up with the CPU clock once per frame
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    frame.gpuToCpu = (int64_t)now() - gpuNow;
+  }
+}
+
+void Profiler::endFrame() { frameNumber++; }
+
+int Profiler::push(const char *name) {
+  Frame &frame = frames[frameNumber % FRAMES_IN_FLIGHT];
+  if (!frame.recorded || frame.scopes.size() >= MAX_SCOPES)
+    return -1;
+  if (events.size() + frame.scopes.size() >= MAX_EVENTS) {
+    if (!traceFull)
+      std::cout << "ERROR::PROFILER::TRACE_FULL " << MAX_EVENTS << " SCOPES, later frames are not recorded" << std::endl;
+    traceFull = true;
+    return -1;
+  }
+
+  Scope scope;
+  scope.name = name;
+  scope.depth = depth++;
+  scope.cpuBegin = now();
+  scope.cpuEnd = 0;
+  frame.scopes.push_back(scope);
+
+  int index = (int)frame.scopes.size() - 1;
+  if (gpuTimer)
+    glQueryCounter(frame.queries[index * 2], GL_TIMESTAMP);
+  return index;
+}
+
+void Profiler::pop(int scope) {
+  Frame &frame = frames[frameNumber % FRAMES_IN_FLIGHT];
+  if (gpuTimer)
+    glQueryCounter(frame.queries[scope * 2 + 1], GL_TIMESTAMP);
+  frame.scopes[scope].cpuEnd = now();
+  depth--;
+}
+
+void Profiler::collect(Frame &frame) {
+  // without a trace only printLastFrame() reads the events
+  if (!keepTrace)
+    events.clear();
+  lastFrameBegin = events.size();
+  for (size_t i = 0; i < frame.scopes.size(); i++) {
+    const Scope &scope = frame.scopes[i];
+    ProfileEvent event;
+    event.name = scope.name;
+    event.frame = frame.number;
+    event.depth = scope.depth;
+    event.cpuBegin = scope.cpuBegin;
+    event.cpuEnd = scope.cpuEnd;
+    event.gpuBegin = event.gpuEnd = 0;
+    if (gpuTimer) {
+      GLuint64 begin = 0, end = 0;
+      glGetQueryObjectui64v(frame.queries[i * 2], GL_QUERY_RESULT, &begin);
+      glGetQueryObjectui64v(frame.queries[i * 2 + 1], GL_QUERY_RESULT, &end);
+      event.gpuBegin = (uint64_t)((int64_t)begin + frame.gpuToCpu);
+      event.gpuEnd = (uint64_t)((int64_t)end + frame.gpuToCpu);
+    }
+    events.push_back(event);
+  }
+  frame.recorded = false;
+}
+
+void Profiler::finish() {
+  // oldest first, so the events stay in frame order
+  for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++) {
+    Frame &frame = frames[(frameNumber + i) % FRAMES_IN_FLIGHT];
+    if (frame.recorded)
+      collect(frame);
+  }
+}
+
+static void writeEvent(std::ostream &out, const ProfileEvent &event, int track, uint64_t begin, uint64_t end) {
+  out << ",\n{\"name\": \"" << event.name << "\", \"ph\": \"X\", \"pid\": 1, \"tid\": " << track << ", \"ts\": " << begin / 1000.0
+      << ", \"dur\": " << (end > begin ? end - begin : 0) / 1000.0 << ", \"args\": {\"frame\": " << event.frame << "}}";
+}
+
+bool Profiler::writeTrace(const char *path) const {
+  std::ofstream out(path);
+  if (!out) {
+    std::cout << "ERROR::PROFILER::TRACE_NOT_WRITTEN " << path << std::endl;
+    return false;
+  }
+
+  // microseconds, the unit of the format
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [";
+  out << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 1, \"args\": {\"name\": \"CPU\"}},";
+  out << "\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": 2, \"args\": {\"name\": \"GPU\"}}";
+  for (size_t i = 0; i < events.size(); i++) {
+    const ProfileEvent &event = events[i];
+    writeEvent(out, event, 1, event.cpuBegin, event.cpuEnd);
+    if (event.gpuEnd != 0)
+      writeEvent(out, event, 2, event.gpuBegin, event.gpuEnd);
+  }
+  out << "\n]}\n";
+  std::cout << "PROFILER::TRACE " << path << " " << events.size() << " SCOPES" << std::endl;
+  return true;
+}
+
+void Profiler::printLastFrame() const {
+  for (size_t i = lastFrameBegin; i < events.size(); i++) {
+    const ProfileEvent &event = events[i];
+    std::cout << "STATS::PROFILE::" << event.name << " CPU " << (event.cpuEnd - event.cpuBegin) / 1e6 << " ms GPU " << (event.gpuEnd - event.gpuBegin) / 1e6 << " ms"
+              << std::endl;
+  }
+}
+
+void Profiler::destroy() {
+  if (gpuTimer) {
+    for (unsigned int i = 0; i < FRAMES_IN_FLIGHT; i++)
+      glDeleteQueries(MAX_SCOPES * 2, frames[i].queries);
+  }
+  if (current == this)
+    current = NULL;
+}
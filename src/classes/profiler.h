@@ -0,0 +1,107 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+// one finished scope, times in nanoseconds on the CPU clock since the profiler started. The GPU times are moved onto
+// that clock too, so both can be drawn on the same timeline
+struct ProfileEvent {
+  const char *name;
+  uint32_t frame;
+  uint32_t depth;
+  uint64_t cpuBegin, cpuEnd;
+  uint64_t gpuBegin, gpuEnd; // 0 when the GPU has no timer
+};
+
+/*
+ Frame profiler with nested scopes, each timed on the CPU with steady_clock and on the GPU with a pair of GL_TIMESTAMP
+ queries (GL_TIME_ELAPSED cannot nest). The queries of a frame are only read FRAMES_IN_FLIGHT frames later, when the
+ GPU has long finished them, so profiling never waits for the GPU: the query objects form a ring of that many frames.
+ GL thread only, like the queries it issues. Names have to outlive the profiler (string literals).
+*/
+class Profiler {
+public:
+  static const unsigned int FRAMES_IN_FLIGHT = 4;
+  static const unsigned int MAX_SCOPES = 256; // per frame, deeper or later scopes are not recorded
+  static const size_t MAX_EVENTS = 1 << 20;   // kept for a trace, recording stops after that
+
+  // where ProfileScope records to, NULL turns every scope into a no-op
+  static Profiler *current;
+
+  // finished scopes in the order they were opened: of every frame read back so far when keeping a trace, otherwise of
+  // the last frame read back only
+  std::vector<ProfileEvent> events;
+
+  explicit Profiler(bool keepTrace = false);
+
+  // reads back the oldest frame in flight and starts recording a new one
+  void beginFrame();
+  void endFrame();
+
+  // ProfileScope calls these, push returns what pop takes
+  int push(const char *name);
+  void pop(int scope);
+
+  // waits for every frame still in flight and reads it back
+  void finish();
+
+  // the events as Chrome trace event JSON (chrome://tracing, Perfetto), CPU and GPU on separate tracks
+  bool writeTrace(const char *path) const;
+
+  // CPU and GPU milliseconds of every scope of the last frame read back, as STATS::PROFILE lines
+  void printLastFrame() const;
+
+  void destroy();
+
+private:
+  struct Scope {
+    const char *name;
+    uint32_t depth;
+    uint64_t cpuBegin, cpuEnd;
+  };
+
+  struct Frame {
+    uint32_t number;
+    bool recorded;
+    int64_t gpuToCpu; // add to a GL timestamp to get nanoseconds on the CPU clock
+    std::vector<Scope> scopes;
+    unsigned int queries[MAX_SCOPES * 2]; // begin and end of each scope
+  };
+
+  Frame frames[FRAMES_IN_FLIGHT];
+  unsigned int frameNumber;
+  uint32_t depth;
+  bool gpuTimer;
+  bool keepTrace;
+  bool traceFull; // MAX_EVENTS reached, reported once
+  size_t lastFrameBegin; // index in events of the last frame read back
+  std::chrono::steady_clock::time_point start;
+
+  uint64_t now() const;
+  void collect(Frame &frame);
+
+  Profiler(const Profiler &);
+  Profiler &operator=(const Profiler &);
+};
+
+// times the rest of the enclosing block under name, on Profiler::current
+class ProfileScope {
+public:
+  explicit ProfileScope(const char *name) : scope(Profiler::current != NULL ? Profiler::current->push(name) : -1) {}
+  ~ProfileScope() {
+    if (scope >= 0)
+      Profiler::current->pop(scope);
+  }
+
+private:
+  int scope;
+
+  ProfileScope(const ProfileScope &);
+  ProfileScope &operator=(const ProfileScope &);
+};
+
+#endif
@@ -0,0 +1,104 @@
+#include <glad/glad.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sys/stat.h>
+#include <vector>
+
+#include "mapped_file.h"
+#include "program_binary_cache.h"
+
+static const uint32_t PROGRAM_BINARY_VERSION = 1;
+
+std::string ProgramBinaryCache::directory = "shader_cache";
+unsigned int ProgramBinaryCache::hits = 0;
+unsigned int ProgramBinaryCache::misses = 0;
+double ProgramBinaryCache::hitSeconds = 0.0;
+double ProgramBinaryCache::missSeconds = 0.0;
+
+// hashes a NUL terminated string including the terminator, so "ab" + "c" and "a" + "bc" differ
+static uint64_t hashString(const char *text, uint64_t seed = 14695981039346656037ull) { return hashBytes(text, text ? strlen(text) + 1 : 0, seed); }
+
+uint64_t ProgramBinaryCache::key(const ShaderSource &vertexSource, const ShaderSource &fragmentSource) {
+  uint64_t hash = hashString((const char *)glGetString(GL_VENDOR));
+  hash = hashString((const char *)glGetString(GL_RENDERER), hash);
+  hash = hashString((const char *)glGetString(GL_VERSION), hash);
+
+  // a separator between the stages, like the terminators above
+  hash = hashBytes("", 1, vertexSource.hash(hash));
+  hash = hashBytes("", 1, fragmentSource.hash(hash));
+  return hash;
+}
+
+std::string ProgramBinaryCache::path(uint64_t key) {
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.progbin", (unsigned long long)key);
+  return directory + "/" + name;
+}
+
+bool ProgramBinaryCache::load(unsigned int program, uint64_t key) {
+  if (!enabled())
+    return false;
+
+  MappedFile file;
+  if (!file.open(path(key).c_str()) || file.size < sizeof(ProgramBinaryHeader))
+    return false;
+
+  const ProgramBinaryHeader &header = *(const ProgramBinaryHeader *)file.data;
+  if (memcmp(header.magic, "PBC1", 4) != 0 || header.version != PROGRAM_BINARY_VERSION || header.key != key)
+    return false;
+  if (sizeof(ProgramBinaryHeader) + header.length > file.size)
+    return false;
+
+  GLExtensions::ProgramBinary(program, header.binaryFormat, file.data + sizeof(ProgramBinaryHeader), header.length);
+
+  int success = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  return success != 0;
+}
+
+void ProgramBinaryCache::prepare(unsigned int program) {
+  if (enabled())
+    GLExtensions::ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ProgramBinaryCache::store(unsigned int program, uint64_t key) {
+  if (!enabled())
+    return;
+
+  int length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  ProgramBinaryHeader header;
+  memcpy(header.magic, "PBC1", 4);
+  header.version = PROGRAM_BINARY_VERSION;
+  header.key = key;
+
+  std::vector<unsigned char> binary(length);
+  GLsizei written = 0;
+  GLenum binaryFormat = 0;
+  GLExtensions::GetProgramBinary(program, length, &written, &binaryFormat, &binary[0]);
+  if (written <= 0)
+    return;
+  header.binaryFormat = binaryFormat;
+  header.length = (uint32_t)written;
+
+  mkdir(directory.c_str(), 0755); // fails harmlessly when it exists
+
+  // written next to the final name and renamed, so a reader never maps a half written file
+  std::string target = path(key);
+  std::string temporary = target + ".tmp";
+  std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+  out.write((const char *)&header, sizeof(header));
+  out.write((const char *)&binary[0], written);
+  out.close();
+
+  if (!out || rename(temporary.c_str(), target.c_str()) != 0) {
+    std::cout << "ERROR::PROGRAM_BINARY_CACHE::FAILED_TO_WRITE " << target << std::endl;
+    remove(temporary.c_str());
+  }
+}
@@ -0,0 +1,58 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+#include "gl_extensions.h"
+#include "shader_source.h"
+
+/*
+ On-disk layout, one file per program named after its key ("<directory>/<key in hex>.progbin"):
+   ProgramBinaryHeader
+   the driver's binary blob, header.length bytes
+*/
+struct ProgramBinaryHeader {
+  char magic[4]; // "PBC1"
+  uint32_t version;
+  uint64_t key;
+  uint32_t binaryFormat; // as returned by glGetProgramBinary, only meaningful to the driver that wrote it
+  uint32_t length;
+};
+
+/*
+ Linked programs saved with glGetProgramBinary and restored with glProgramBinary, so a warm start skips GLSL
+ compilation entirely. The key hashes the exact sources handed to glShaderSource (includes resolved) together with the vendor, renderer
+ and version strings, so editing a shader or updating the driver simply misses. A driver may still reject a binary
+ it wrote (glProgramBinary then leaves the program unlinked), load() reports that as a miss too.
+*/
+class ProgramBinaryCache {
+public:
+  // where the binaries go, created on the first store. Empty turns the cache off
+  static std::string directory;
+
+  // programs restored and programs compiled since startup, with the time Shader spent on each
+  static unsigned int hits, misses;
+  static double hitSeconds, missSeconds;
+
+  static bool enabled() { return !directory.empty() && GLExtensions::programBinary; }
+
+  // GL thread only, the driver strings are part of the key
+  static uint64_t key(const ShaderSource &vertexSource, const ShaderSource &fragmentSource);
+
+  // links program from the cached binary, false if there is none or the driver refused it
+  static bool load(unsigned int program, uint64_t key);
+
+  // call before glLinkProgram on programs that will be stored, some drivers only keep the binary when asked to
+  static void prepare(unsigned int program);
+
+  // saves a linked program
+  static void store(unsigned int program, uint64_t key);
+
+private:
+  static std::string path(uint64_t key);
+};
+
+#endif
@@ -0,0 +1,204 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "gl_state_cache.h"
+#include "render_queue.h"
+#include "shader.h"
+
+static const int PASS_SHIFT = 60;
+static const uint64_t DEPTH_MAX = (1u << 24) - 1;
+static const uint64_t ID_MASK = (1ull << 36) - 1; // program, texture set and mesh together
+
+RenderQueue::RenderQueue() : sorted(true), frames(0), depthScale(0.0f) { resetFrameStats(); }
+
+uint16_t RenderQueue::addProgram(Shader *program, const char *const *samplers, unsigned int samplerCount) {
+  if (programs.size() >= MAX_PROGRAMS) {
+    std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_PROGRAMS" << std::endl;
+    return 0;
+  }
+
+  // samplers are program state, they only have to be set once
+  program->use();
+  for (unsigned int i = 0; i < samplerCount; i++)
+    program->setInt(program->getUniformHandle(samplers[i]), (int)i);
+
+  Program entry;
+  entry.shader = program;
+  entry.modelHandle = program->getUniformHandle("model");
+  programs.push_back(entry);
+  return (uint16_t)(programs.size() - 1);
+}
+
+uint16_t RenderQueue::addTextureSet(const unsigned int *textures, unsigned int count) {
+  if (textureSets.size() >= MAX_TEXTURE_SETS || count > MAX_SET_TEXTURES) {
+    std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_TEXTURES" << std::endl;
+    return 0;
+  }
+
+  TextureSet set;
+  memset(&set, 0, sizeof(set));
+  memcpy(set.textures, textures, count * sizeof(unsigned int));
+  set.count = count;
+  textureSets.push_back(set);
+  return (uint16_t)(textureSets.size() - 1);
+}
+
+uint16_t RenderQueue::addMesh(unsigned int vertexArray, GLsizei indexCount, GLenum indexType, MeshUniformsFunction setUniforms, const void *user,
+                              MeshInstancesFunction fillInstances) {
+  if (meshes.size() >= MAX_MESHES) {
+    std::cout << "ERROR::RENDER_QUEUE::TOO_MANY_MESHES" << std::endl;
+    return 0;
+  }
+
+  Mesh mesh;
+  mesh.vertexArray = vertexArray;
+  mesh.indexCount = indexCount;
+  mesh.indexType = indexType;
+  mesh.setUniforms = setUniforms;
+  mesh.fillInstances = fillInstances;
+  mesh.user = user;
+  meshes.push_back(mesh);
+  return (uint16_t)(meshes.size() - 1);
+}
+
+void RenderQueue::begin(float maxDepth) {
+  commands.clear();
+  order.clear();
+  sorted = true;
+  frames++;
+  depthScale = maxDepth > 0.0f ? (float)DEPTH_MAX / maxDepth : 0.0f;
+}
+
+uint64_t RenderQueue::makeKey(RenderPass pass, uint16_t program, uint16_t textureSet, uint16_t mesh, uint32_t depth) {
+  uint64_t ids = ((uint64_t)(program & (MAX_PROGRAMS - 1)) << 26) | ((uint64_t)(textureSet & (MAX_TEXTURE_SETS - 1)) << 12) | (mesh & (MAX_MESHES - 1));
+  uint64_t key = (uint64_t)pass << PASS_SHIFT;
+  if (pass == RENDER_PASS_TRANSLUCENT)
+    return key | ((DEPTH_MAX - depth) << 36) | ids;
+  return key | (ids << 24) | depth;
+}
+
+void RenderQueue::submit(RenderPass pass, uint16_t program, uint16_t textureSet, uint16_t mesh, float depth, const glm::mat4 *model, uint32_t instanceCount,
+                         const void *instances) {
+  float scaled = depth * depthScale;
+  uint32_t quantized = scaled <= 0.0f ? 0 : scaled >= (float)DEPTH_MAX ? (uint32_t)DEPTH_MAX : (uint32_t)scaled;
+
+  DrawCommand command;
+  command.key = makeKey(pass, program, textureSet, mesh, quantized);
+  command.model = model;
+  command.instanceCount = instanceCount;
+  command.instances = instances;
+  commands.push_back(command);
+  sorted = false;
+  stats.submitted++;
+}
+
+/*
+ Least significant digit first radix sort, 8 bits per pass. The histograms of all eight digits are counted in one
+ read of the keys, and a digit that is the same in every key (the pass in most frames, the high id bits of a small
+ scene) is skipped without moving anything. Each pass is stable, so commands with equal keys stay in submission order.
+*/
+void RenderQueue::sort() {
+  if (sorted)
+    return;
+  sorted = true;
+
+  size_t count = commands.size();
+  order.resize(count);
+  scratch.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    order[i].key = commands[i].key;
+    order[i].command = (uint32_t)i;
+  }
+  stats.sorted += (unsigned int)count;
+  if (count < 2)
+    return;
+
+  uint32_t histograms[8][256];
+  memset(histograms, 0, sizeof(histograms));
+  for (size_t i = 0; i < count; i++) {
+    uint64_t key = order[i].key;
+    for (int digit = 0; digit < 8; digit++)
+      histograms[digit][(key >> (digit * 8)) & 0xff]++;
+  }
+
+  SortItem *from = &order[0], *to = &scratch[0];
+  for (int digit = 0; digit < 8; digit++) {
+    uint32_t *histogram = histograms[digit];
+    if (histogram[(from[0].key >> (digit * 8)) & 0xff] == count)
+      continue;
+
+    // counts to starting offsets
+    uint32_t offset = 0;
+    for (int bucket = 0; bucket < 256; bucket++) {
+      uint32_t bucketCount = histogram[bucket];
+      histogram[bucket] = offset;
+      offset += bucketCount;
+    }
+    for (size_t i = 0; i < count; i++)
+      to[histogram[(from[i].key >> (digit * 8)) & 0xff]++] = from[i];
+
+    std::swap(from, to);
+    stats.sortPasses++;
+  }
+
+  // an odd number of passes leaves the result in scratch
+  if (from != &order[0])
+    order.swap(scratch);
+}
+
+void RenderQueue::execute() {
+  sort();
+
+  // state of the previous command, ids that cannot occur so the first command sets everything
+  int program = -1, textureSet = -1, mesh = -1;
+  const Program *currentProgram = NULL;
+  const Mesh *currentMesh = NULL;
+
+  for (size_t i = 0; i < order.size(); i++) {
+    const DrawCommand &command = commands[order[i].command];
+    uint64_t key = command.key;
+    uint64_t ids = (key >> PASS_SHIFT) == RENDER_PASS_TRANSLUCENT ? key & ID_MASK : (key >> 24) & ID_MASK;
+    int nextProgram = (int)(ids >> 26), nextTextureSet = (int)((ids >> 12) & (MAX_TEXTURE_SETS - 1)), nextMesh = (int)(ids & (MAX_MESHES - 1));
+
+    bool programChanged = nextProgram != program;
+    if (programChanged) {
+      program = nextProgram;
+      currentProgram = &programs[program];
+      currentProgram->shader->use();
+      stats.programChanges++;
+    }
+
+    if (nextTextureSet != textureSet) {
+      textureSet = nextTextureSet;
+      const TextureSet &set = textureSets[textureSet];
+      for (unsigned int unit = 0; unit < set.count; unit++)
+        GLStateCache::bindTexture(unit, set.textures[unit]);
+      stats.textureSetChanges++;
+    }
+
+    if (nextMesh != mesh || programChanged) {
+      if (nextMesh != mesh) {
+        mesh = nextMesh;
+        currentMesh = &meshes[mesh];
+        GLStateCache::bindVertexArray(currentMesh->vertexArray);
+        stats.meshChanges++;
+      }
+      // mesh uniforms live in the program, a new program needs them again
+      if (currentMesh->setUniforms != NULL)
+        currentMesh->setUniforms(*currentProgram->shader, currentMesh->user);
+    }
+
+    if (command.instances != NULL && currentMesh->fillInstances != NULL && !currentMesh->fillInstances(command.instances, command.instanceCount, currentMesh->user))
+      continue;
+    if (command.model != NULL)
+      currentProgram->shader->setMat4(currentProgram->modelHandle, *command.model);
+    if (command.instanceCount > 0)
+      glDrawElementsInstanced(GL_TRIANGLES, currentMesh->indexCount, currentMesh->indexType, (void *)0, (GLsizei)command.instanceCount);
+    else
+      glDrawElements(GL_TRIANGLES, currentMesh->indexCount, currentMesh->indexType, (void *)0);
+    stats.drawCalls++;
+  }
+}
+
+void RenderQueue::resetFrameStats() { memset(&stats, 0, sizeof(stats)); }
@@ -0,0 +1,130 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Shader;
+
+enum RenderPass {
+  RENDER_PASS_OPAQUE = 0,      // front to back within a state bucket, so early depth testing rejects what is hidden
+  RENDER_PASS_TRANSLUCENT = 1, // back to front before anything else, blending needs it
+  RENDER_PASS_OVERLAY = 2,
+};
+
+// sets the uniforms a mesh needs in a program (e.g. its dequantization), called whenever either of them changes
+typedef void (*MeshUniformsFunction)(Shader &program, const void *user);
+
+// fills the instance buffer of a mesh's VAO right before one of its instanced draws, from what was passed to submit().
+// false skips the draw
+typedef bool (*MeshInstancesFunction)(const void *instances, uint32_t instanceCount, const void *user);
+
+/*
+ One draw, as small as it can be: everything it needs is in the key or behind the ids the key holds. model is set as
+ the program's "model" uniform, and may be NULL for instanced draws, whose VAO reads its own instance buffer.
+ Instanced draws of one mesh share that buffer, so instances is handed to the mesh's MeshInstancesFunction to fill it
+ just before the draw. Both pointers have to stay valid until execute().
+*/
+struct DrawCommand {
+  uint64_t key;
+  const glm::mat4 *model;
+  uint32_t instanceCount;  // 0 for a plain glDrawElements
+  const void *instances;   // NULL when the instance buffer is already filled
+};
+
+/*
+ Deferred draw submission. Producers register their programs, texture sets and meshes once, then push one DrawCommand
+ per draw each frame, in any order. execute() sorts the commands by key with a radix sort and replays them, changing
+ only the state that differs from the previous command: the key orders pass, program, texture set, mesh and depth from
+ the most to the least expensive change, so draws that share state end up next to each other and the state is set
+ once per run of them.
+ Opaque key:      pass:4 | program:10 | texture set:14 | mesh:12 | depth:24
+ Translucent key: pass:4 | inverted depth:24 | program:10 | texture set:14 | mesh:12
+*/
+class RenderQueue {
+public:
+  static const unsigned int MAX_PROGRAMS = 1 << 10;
+  static const unsigned int MAX_TEXTURE_SETS = 1 << 14;
+  static const unsigned int MAX_MESHES = 1 << 12;
+  static const unsigned int MAX_SET_TEXTURES = 4;
+
+  // counted since the last resetFrameStats()
+  struct Stats {
+    unsigned int submitted;
+    unsigned int sorted;
+    unsigned int sortPasses; // 8 bit digits that were not the same in every key
+    unsigned int drawCalls;
+    unsigned int programChanges, textureSetChanges, meshChanges;
+
+    unsigned int stateChanges() const { return programChanges + textureSetChanges + meshChanges; }
+  };
+  Stats stats;
+
+  RenderQueue();
+
+  // the ids below are what submit() takes. samplers are the program's texture uniforms, bound to units 0, 1, ...
+  uint16_t addProgram(Shader *program, const char *const *samplers = NULL, unsigned int samplerCount = 0);
+  uint16_t addTextureSet(const unsigned int *textures, unsigned int count);
+  uint16_t addMesh(unsigned int vertexArray, GLsizei indexCount, GLenum indexType, MeshUniformsFunction setUniforms = NULL, const void *user = NULL,
+                   MeshInstancesFunction fillInstances = NULL);
+
+  // starts a new frame of commands. Depths are view space distances, anything beyond maxDepth sorts as maxDepth
+  void begin(float maxDepth);
+  // begin() calls so far, tells producers that keep per frame data for their commands when it can be dropped
+  unsigned int frame() const { return frames; }
+
+  void submit(RenderPass pass, uint16_t program, uint16_t textureSet, uint16_t mesh, float depth, const glm::mat4 *model, uint32_t instanceCount = 0,
+              const void *instances = NULL);
+
+  // sorts the commands submitted since begin(), execute() does it too if it has not been done
+  void sort();
+  void execute();
+
+  size_t size() const { return commands.size(); }
+
+  static uint64_t makeKey(RenderPass pass, uint16_t program, uint16_t textureSet, uint16_t mesh, uint32_t depth);
+
+  void resetFrameStats();
+
+private:
+  struct Program {
+    Shader *shader;
+    int modelHandle;
+  };
+
+  struct TextureSet {
+    unsigned int textures[MAX_SET_TEXTURES];
+    unsigned int count;
+  };
+
+  struct Mesh {
+    unsigned int vertexArray;
+    GLsizei indexCount;
+    GLenum indexType;
+    MeshUniformsFunction setUniforms;
+    MeshInstancesFunction fillInstances;
+    const void *user;
+  };
+
+  // a key and the command it came from, what the radix sort moves around
+  struct SortItem {
+    uint64_t key;
+    uint32_t command;
+  };
+
+  std::vector<Program> programs;
+  std::vector<TextureSet> textureSets;
+  std::vector<Mesh> meshes;
+
+  std::vector<DrawCommand> commands;
+  std::vector<SortItem> order, scratch;
+  bool sorted;
+  unsigned int frames;
+  float depthScale; // maps [0, maxDepth] to the 24 bits of the key
+};
+
+#endif
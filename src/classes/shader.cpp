@@ -1,92 +1,252 @@
 #include <glad/glad.h>
 
 #include <GLFW/glfw3.h>
-#include <fstream>
+#include <algorithm>
+#include <chrono>
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
-#include <sstream>
 #include <string>
 
+#include "frame_uniforms.hpp"
+#include "gl_extensions.h"
+#include "gl_state_cache.h"
+#include "program_binary_cache.h"
 #include "shader.h"
+#include "shader_source.h"
+
+unsigned int Shader::lookupsAvoided = 0;
+
+// everything finishLink() needs from the submission, alive between the two
+struct Shader::PendingLink {
+  std::string name;
+  std::chrono::steady_clock::time_point start;
+  uint64_t binaryKey;
+  bool cached;
+  unsigned int vertex, fragment; // 0 when restored from a binary
+};
+
+Shader::Shader(const char *vertexPath, const char *fragmentPath, bool waitForLink) : pending(NULL) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+  // both sources stay mapped until they are submitted, glShaderSource copies them straight out of the page cache
+  ShaderSource vertexSrc, fragmentSrc;
+  vertexSrc.load(vertexPath);
+  fragmentSrc.load(fragmentPath);
+
+  submit(vertexPath, vertexSrc, fragmentSrc, start);
+  if (waitForLink)
+    finishLink();
+}
 
-Shader::Shader(const char *vertexPath, const char *fragmentPath) {
-  std::string vertexSrc;
-  std::string fragmentSrc;
-  std::ifstream vShaderFile;
-  std::ifstream fShaderFile;
-  // ensure ifstream can throw exceptions
-  vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  try {
-    // open file
-    vShaderFile.open(vertexPath);
-    fShaderFile.open(fragmentPath);
-    std::stringstream vShaderStream, fShaderStream;
-    // read file's buffer contents into streams
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
-    // close handlers
-    vShaderFile.close();
-    fShaderFile.close();
-    // convert stream to string
-    vertexSrc = vShaderStream.str();
-    fragmentSrc = fShaderStream.str();
-  } catch (std::ifstream::failure e) {
-    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ" << std::endl;
-  }
+Shader::Shader(const char *name, const ShaderSource &vertexSrc, const ShaderSource &fragmentSrc, bool waitForLink) : pending(NULL) {
+  submit(name, vertexSrc, fragmentSrc, std::chrono::steady_clock::now());
+  if (waitForLink)
+    finishLink();
+}
+
+void Shader::submit(const char *name, const ShaderSource &vertexSrc, const ShaderSource &fragmentSrc, std::chrono::steady_clock::time_point start) {
+  pending = new PendingLink();
+  pending->name = name;
+  pending->start = start;
+  pending->vertex = 0;
+  pending->fragment = 0;
+
+  ID = glCreateProgram();
+
+  // a warm start restores the linked program, a miss (or a binary the driver refused) compiles from source as usual
+  pending->binaryKey = ProgramBinaryCache::key(vertexSrc, fragmentSrc);
+  pending->cached = ProgramBinaryCache::load(ID, pending->binaryKey);
+  if (pending->cached)
+    return;
+
+  // no status queries in here: asking for GL_COMPILE_STATUS would make the driver finish each compile before the next one starts
+  pending->vertex = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(pending->vertex, vertexSrc.count(), vertexSrc.strings(), vertexSrc.lengths());
+  glCompileShader(pending->vertex);
+
+  pending->fragment = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(pending->fragment, fragmentSrc.count(), fragmentSrc.strings(), fragmentSrc.lengths());
+  glCompileShader(pending->fragment);
+
+  glAttachShader(ID, pending->vertex);
+  glAttachShader(ID, pending->fragment);
+
+  ProgramBinaryCache::prepare(ID);
+  glLinkProgram(ID);
+}
+
+bool Shader::linkCompleted() const {
+  if (pending == NULL)
+    return true;
+  if (!GLExtensions::parallelShaderCompile)
+    return false; // no way to ask without waiting
 
-  const char *vShaderCode = vertexSrc.c_str();
-  const char *fShaderCode = fragmentSrc.c_str();
+  int completed = 0;
+  glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &completed);
+  return completed != 0;
+}
+
+void Shader::finishLink() const {
+  if (pending == NULL)
+    return;
 
-  unsigned int vertex, fragment;
   int success;
   char infoLog[512];
 
-  vertex = glCreateShader(GL_VERTEX_SHADER);
-  glShaderSource(vertex, 1, &vShaderCode, NULL);
-  glCompileShader(vertex);
-  glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-
+  glGetProgramiv(ID, GL_LINK_STATUS, &success);
   if (!success) {
-    glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-    std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    // the compile logs explain most link failures, so they are only fetched now
+    glGetShaderiv(pending->vertex, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      glGetShaderInfoLog(pending->vertex, 512, NULL, infoLog);
+      std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    glGetShaderiv(pending->fragment, GL_COMPILE_STATUS, &success);
+    if (!success) {
+      glGetShaderInfoLog(pending->fragment, 512, NULL, infoLog);
+      std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+    }
+
+    glGetProgramInfoLog(ID, 512, NULL, infoLog);
+    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+  } else if (!pending->cached) {
+    ProgramBinaryCache::store(ID, pending->binaryKey);
   }
 
-  fragment = glCreateShader(GL_FRAGMENT_SHADER);
-  glShaderSource(fragment, 1, &fShaderCode, NULL);
-  glCompileShader(fragment);
-  glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
+  if (!pending->cached) {
+    glDetachShader(ID, pending->vertex);
+    glDetachShader(ID, pending->fragment);
+    glDeleteShader(pending->vertex);
+    glDeleteShader(pending->fragment);
+  }
 
-  if (!success) {
-    glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-    std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+  // from submission to now, so for a batch this includes the time spent waiting on the others
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - pending->start).count();
+  if (pending->cached) {
+    ProgramBinaryCache::hits++;
+    ProgramBinaryCache::hitSeconds += seconds;
+  } else {
+    ProgramBinaryCache::misses++;
+    ProgramBinaryCache::missSeconds += seconds;
   }
+  std::cout << "SHADER::PROGRAM " << pending->name << " " << (pending->cached ? "CACHE_HIT " : "COMPILED ") << seconds * 1000.0 << " ms" << std::endl;
 
-  ID = glCreateProgram();
+  delete pending;
+  pending = NULL;
 
-  glAttachShader(ID, vertex);
-  glAttachShader(ID, fragment);
+  cacheUniformLocations();
 
-  glLinkProgram(ID);
-  glGetProgramiv(ID, GL_LINK_STATUS, &success);
+  // programs that read the per frame block get it from the shared binding point, nothing to upload per program
+  unsigned int frameBlock = glGetUniformBlockIndex(ID, FRAME_UNIFORMS_BLOCK);
+  if (frameBlock != GL_INVALID_INDEX)
+    glUniformBlockBinding(ID, frameBlock, FRAME_UNIFORMS_BINDING);
+}
 
-  if (!success) {
-    glGetProgramInfoLog(ID, 512, NULL, infoLog);
-    std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
+void Shader::cacheUniformLocations() const {
+  uniformNames.clear();
+  uniformLocations.clear();
+
+  int count = 0;
+  int maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+
+  std::vector<std::pair<std::string, int> > uniforms;
+  std::vector<char> nameBuffer(maxLength + 1);
+
+  for (int i = 0; i < count; i++) {
+    int length = 0, size = 0;
+    GLenum type;
+    glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), &length, &size, &type, nameBuffer.data());
+
+    std::string name(nameBuffer.data(), length);
+    // arrays are reported as "name[0]", but are set through the plain name
+    if (name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0)
+      name.erase(name.size() - 3);
+
+    // uniforms living in a uniform block have no location
+    int location = glGetUniformLocation(ID, name.c_str());
+    if (location != -1)
+      uniforms.push_back(std::make_pair(name, location));
   }
 
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
+  std::sort(uniforms.begin(), uniforms.end());
+  for (size_t i = 0; i < uniforms.size(); i++) {
+    uniformNames.push_back(uniforms[i].first);
+    uniformLocations.push_back(uniforms[i].second);
+  }
+}
+
+int Shader::getUniformHandle(const std::string &name) const {
+  finishLink();
+  std::vector<std::string>::const_iterator it = std::lower_bound(uniformNames.begin(), uniformNames.end(), name);
+  if (it == uniformNames.end() || *it != name)
+    return -1;
+  return uniformLocations[it - uniformNames.begin()];
 }
 
-void Shader::use() { glUseProgram(ID); }
+void Shader::use() {
+  finishLink();
+  GLStateCache::useProgram(ID);
+}
+
+Shader::~Shader() { delete pending; }
+
+void Shader::destroy() {
+  // a link nobody waited for is dropped without waiting for it now
+  if (pending != NULL) {
+    if (!pending->cached) {
+      glDeleteShader(pending->vertex);
+      glDeleteShader(pending->fragment);
+    }
+    delete pending;
+    pending = NULL;
+  }
+  GLStateCache::forgetProgram(ID);
+  glDeleteProgram(ID);
+}
 
-void Shader::destroy() { glDeleteProgram(ID); }
+void Shader::resetFrameStats() { lookupsAvoided = 0; }
 
-void Shader::setBool(const std::string &name, bool value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); }
+void Shader::setBool(const std::string &name, bool value) const { setBool(getUniformHandle(name), value); }
 
-void Shader::setInt(const std::string &name, int value) const { glUniform1i(glGetUniformLocation(ID, name.c_str()), value); }
+void Shader::setInt(const std::string &name, int value) const { setInt(getUniformHandle(name), value); }
 
-void Shader::setFloat(const std::string &name, float value) const { glUniform1f(glGetUniformLocation(ID, name.c_str()), value); }
+void Shader::setFloat(const std::string &name, float value) const { setFloat(getUniformHandle(name), value); }
+
+void Shader::setVec2(const std::string &name, const glm::vec2 &value) const { setVec2(getUniformHandle(name), value); }
+
+void Shader::setVec3(const std::string &name, const glm::vec3 &value) const { setVec3(getUniformHandle(name), value); }
+
+void Shader::setMat4(const std::string &name, glm::mat4 matrix) const { setMat4(getUniformHandle(name), matrix); }
+
+void Shader::setBool(int handle, bool value) const {
+  lookupsAvoided++;
+  glUniform1i(handle, (int)value);
+}
+
+void Shader::setInt(int handle, int value) const {
+  lookupsAvoided++;
+  glUniform1i(handle, value);
+}
+
+void Shader::setFloat(int handle, float value) const {
+  lookupsAvoided++;
+  glUniform1f(handle, value);
+}
+
+void Shader::setVec2(int handle, const glm::vec2 &value) const {
+  lookupsAvoided++;
+  glUniform2f(handle, value.x, value.y);
+}
+
+void Shader::setVec3(int handle, const glm::vec3 &value) const {
+  lookupsAvoided++;
+  glUniform3f(handle, value.x, value.y, value.z);
+}
 
-void Shader::setMat4(const std::string &name, glm::mat4 matrix) const { glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, glm::value_ptr(matrix)); }
\ No newline at end of file
+void Shader::setMat4(int handle, const glm::mat4 &matrix) const {
+  lookupsAvoided++;
+  glUniformMatrix4fv(handle, 1, GL_FALSE, glm::value_ptr(matrix));
+}
\ No newline at end of file
@@ -3,26 +3,82 @@
 
 #include <glad/glad.h>
 
+#include <chrono>
 #include <glm/gtc/type_ptr.hpp>
 #include <string>
+#include <vector>
+
+class ShaderSource;
 
 class Shader {
 public:
   unsigned int ID;
 
-  // constructor
-  Shader(const char *vertexPath, const char *fragmentPath);
+  // uniform sets that would have called glGetUniformLocation before the location table existed, since the last resetFrameStats()
+  static unsigned int lookupsAvoided;
+
+  /*
+   Submits the compile and link. With waitForLink false nothing waits for the driver here: the program is finished
+   (status checked, uniforms looked up) on its first use(), getUniformHandle() or finishLink(), so many programs
+   can compile side by side in the driver. See ShaderLibrary
+  */
+  Shader(const char *vertexPath, const char *fragmentPath, bool waitForLink = true);
+
+  // from sources already assembled in memory, name is only used in messages
+  Shader(const char *name, const ShaderSource &vertexSrc, const ShaderSource &fragmentSrc, bool waitForLink = true);
+
+  // frees a link that was never finished, the GL objects go with destroy()
+  ~Shader();
+
+  // true once the program is linked and checking it will not block. Without GL_KHR_parallel_shader_compile there is
+  // no way to ask, so it stays false until finishLink()
+  bool linkCompleted() const;
+
+  // blocks until the program is linked, then checks it and looks up its uniforms. Cheap once done
+  void finishLink() const;
 
   // activate shader
   void use();
 
   void destroy();
 
+  // resolves a uniform once so it can be set by handle every frame. Returns -1 (ignored by the setters) if the uniform is not active
+  int getUniformHandle(const std::string &name) const;
+
   // uniform utility functions
   void setBool(const std::string &name, bool value) const;
   void setInt(const std::string &name, int value) const;
   void setFloat(const std::string &name, float value) const;
+  void setVec2(const std::string &name, const glm::vec2 &value) const;
+  void setVec3(const std::string &name, const glm::vec3 &value) const;
   void setMat4(const std::string &name, glm::mat4 matrix) const;
+
+  // handle based variants, no name lookup at all
+  void setBool(int handle, bool value) const;
+  void setInt(int handle, int value) const;
+  void setFloat(int handle, float value) const;
+  void setVec2(int handle, const glm::vec2 &value) const;
+  void setVec3(int handle, const glm::vec3 &value) const;
+  void setMat4(int handle, const glm::mat4 &matrix) const;
+
+  static void resetFrameStats();
+
+private:
+  struct PendingLink;
+
+  // filled in lazily by finishLink(), which const methods call too, hence mutable
+  mutable PendingLink *pending;
+
+  // active uniforms of the linked program, sorted by name. Kept as two flat arrays so the binary search only touches the names
+  mutable std::vector<std::string> uniformNames;
+  mutable std::vector<int> uniformLocations;
+
+  void submit(const char *name, const ShaderSource &vertexSrc, const ShaderSource &fragmentSrc, std::chrono::steady_clock::time_point start);
+  void cacheUniformLocations() const;
+
+  // owns pending and the program, copies would free both twice
+  Shader(const Shader &);
+  Shader &operator=(const Shader &);
 };
 
 unsigned int buildShaderProgram();
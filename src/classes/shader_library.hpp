@@ -0,0 +1,84 @@
+#ifndef SHADER_LIBRARY_H
+#define SHADER_LIBRARY_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "gl_extensions.h"
+#include "shader.h"
+#include "shader_source.h"
+
+/*
+ Submits the compiles and links of many programs up front and checks on them later, so the driver can work on
+ all of them at once instead of finishing one before it sees the next. With GL_KHR_parallel_shader_compile the
+ driver spreads them over its own threads and poll() finds out without blocking which are done; without it they
+ still overlap with whatever the application does until their first use.
+*/
+class ShaderLibrary {
+public:
+  ShaderLibrary() {
+    if (GLExtensions::MaxShaderCompilerThreads)
+      GLExtensions::MaxShaderCompilerThreads(0xFFFFFFFF); // as many threads as the driver likes
+  }
+
+  ~ShaderLibrary() {
+    for (size_t i = 0; i < shaders.size(); i++)
+      delete shaders[i];
+  }
+
+  // the shader is owned by the library. It can be used right away, its first use waits for the link
+  Shader *add(const char *vertexPath, const char *fragmentPath) {
+    shaders.push_back(new Shader(vertexPath, fragmentPath, false));
+    return shaders.back();
+  }
+
+  Shader *add(const char *name, const ShaderSource &vertexSrc, const ShaderSource &fragmentSrc) {
+    shaders.push_back(new Shader(name, vertexSrc, fragmentSrc, false));
+    return shaders.back();
+  }
+
+  // a program added under a key, e.g. by ShaderPermutations as (source hash, feature mask). NULL if there is none yet
+  Shader *find(uint64_t sourceHash, unsigned int features) const {
+    std::map<std::pair<uint64_t, unsigned int>, Shader *>::const_iterator it = keyed.find(std::make_pair(sourceHash, features));
+    return it == keyed.end() ? NULL : it->second;
+  }
+
+  Shader *add(const char *name, const ShaderSource &vertexSrc, const ShaderSource &fragmentSrc, uint64_t sourceHash, unsigned int features) {
+    Shader *shader = add(name, vertexSrc, fragmentSrc);
+    keyed[std::make_pair(sourceHash, features)] = shader;
+    return shader;
+  }
+
+  // finishes the programs the driver reports done, never blocks. Returns how many are left for their first use or finishAll()
+  unsigned int poll() {
+    unsigned int compiling = 0;
+    for (size_t i = 0; i < shaders.size(); i++) {
+      if (shaders[i]->linkCompleted())
+        shaders[i]->finishLink();
+      else
+        compiling++;
+    }
+    return compiling;
+  }
+
+  // blocks until every program is linked
+  void finishAll() {
+    for (size_t i = 0; i < shaders.size(); i++)
+      shaders[i]->finishLink();
+  }
+
+  void destroy() {
+    for (size_t i = 0; i < shaders.size(); i++)
+      shaders[i]->destroy();
+  }
+
+private:
+  std::vector<Shader *> shaders;
+  std::map<std::pair<uint64_t, unsigned int>, Shader *> keyed;
+};
+
+#endif
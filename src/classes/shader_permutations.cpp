@@ -0,0 +1,44 @@
+#include <glad/glad.h>
+
+#include <cstring>
+#include <string>
+
+#include "shader_permutations.h"
+
+// static, the pieces of every variant point at them
+static const char *const FEATURE_NAMES[SHADER_FEATURE_COUNT] = {"INSTANCED", "TEXTURE2_BLEND", "VERTEX_COLOR"};
+static const char *const FEATURE_DEFINES[SHADER_FEATURE_COUNT] = {"#define INSTANCED\n", "#define TEXTURE2_BLEND\n", "#define VERTEX_COLOR\n"};
+
+ShaderPermutations::ShaderPermutations(ShaderLibrary &library, const char *vertexPath, const char *fragmentPath) : library(library), vertexPath(vertexPath) {
+  vertexSrc.load(vertexPath);
+  fragmentSrc.load(fragmentPath);
+  sourceHash = fragmentSrc.hash(vertexSrc.hash());
+}
+
+Shader *ShaderPermutations::get(unsigned int features) {
+  Shader *shader = library.find(sourceHash, features);
+  if (shader)
+    return shader;
+
+  ShaderSource vertexVariant, fragmentVariant;
+  vertexVariant.addSource(vertexSrc);
+  fragmentVariant.addSource(fragmentSrc);
+
+  // "vertex.glsl [INSTANCED TEXTURE2_BLEND]" in the compile messages
+  std::string name = vertexPath + " [";
+  for (unsigned int bit = 0; bit < SHADER_FEATURE_COUNT; bit++) {
+    if (features & (1u << bit))
+      name += std::string(name[name.size() - 1] == '[' ? "" : " ") + FEATURE_NAMES[bit];
+  }
+  name += "]";
+
+  // backwards, since every insertion lands in front of the previous one
+  for (unsigned int bit = SHADER_FEATURE_COUNT; bit-- > 0;) {
+    if (features & (1u << bit)) {
+      vertexVariant.insertAfterVersion(FEATURE_DEFINES[bit], strlen(FEATURE_DEFINES[bit]));
+      fragmentVariant.insertAfterVersion(FEATURE_DEFINES[bit], strlen(FEATURE_DEFINES[bit]));
+    }
+  }
+
+  return library.add(name.c_str(), vertexVariant, fragmentVariant, sourceHash, features);
+}
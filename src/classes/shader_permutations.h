@@ -0,0 +1,42 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+#include "shader.h"
+#include "shader_library.hpp"
+#include "shader_source.h"
+
+// feature bits of a permutation, each one turns into "#define <NAME>" in both stages
+enum ShaderFeature {
+  FEATURE_INSTANCED = 1 << 0,      // model matrix per instance from attributes 2 to 5 instead of the model uniform
+  FEATURE_TEXTURE2_BLEND = 1 << 1, // mixes texture2 over texture1
+  FEATURE_VERTEX_COLOR = 1 << 2,   // multiplies by a per vertex color from attribute 6
+};
+
+const unsigned int SHADER_FEATURE_COUNT = 3;
+
+/*
+ Specialized variants of one vertex/fragment pair. The files are mapped once; a variant is the same pieces with the
+ feature defines spliced in after #version, so hot shaders get their branches resolved by the compiler instead of
+ at runtime. Variants are compiled lazily, on the first get() for their feature mask, through the library (which
+ caches them by source hash and mask), and their first use waits for the link.
+*/
+class ShaderPermutations {
+public:
+  ShaderPermutations(ShaderLibrary &library, const char *vertexPath, const char *fragmentPath);
+
+  // the program with exactly these features (a mask of ShaderFeature bits)
+  Shader *get(unsigned int features);
+
+private:
+  ShaderLibrary &library;
+  std::string vertexPath;
+  ShaderSource vertexSrc, fragmentSrc;
+  uint64_t sourceHash;
+};
+
+#endif
@@ -0,0 +1,182 @@
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "shader_source.h"
+
+bool ShaderSource::load(const char *path) {
+  clear();
+  return append(path);
+}
+
+void ShaderSource::clear() {
+  for (size_t i = 0; i < files.size(); i++)
+    delete files[i];
+  files.clear();
+  includedPaths.clear();
+  pieces.clear();
+  pieceLengths.clear();
+}
+
+uint64_t ShaderSource::hash(uint64_t seed) const {
+  uint64_t hash = seed;
+  for (size_t i = 0; i < pieces.size(); i++)
+    hash = hashBytes(pieces[i], pieceLengths[i], hash);
+  return hash;
+}
+
+void ShaderSource::addPiece(const char *text, size_t length) {
+  if (length == 0)
+    return;
+  pieces.push_back(text);
+  pieceLengths.push_back((GLint)length);
+}
+
+void ShaderSource::addSource(const ShaderSource &other) {
+  pieces.insert(pieces.end(), other.pieces.begin(), other.pieces.end());
+  pieceLengths.insert(pieceLengths.end(), other.pieceLengths.begin(), other.pieceLengths.end());
+}
+
+/*
+ Finds the '#' of a directive on line (up to end) the way the preprocessor does: comments count as whitespace, so the
+ '#' has to be the first thing on the line outside of them. inComment carries an open block comment to the next line.
+*/
+static bool findDirective(const char *line, const char *end, bool &inComment, const char *&directive) {
+  directive = NULL;
+  bool first = true;
+  for (const char *c = line; c < end; c++) {
+    if (inComment) {
+      if (*c == '*' && c + 1 < end && c[1] == '/') {
+        inComment = false;
+        c++;
+      }
+      continue;
+    }
+    if (*c == '/' && c + 1 < end && c[1] == '*') {
+      inComment = true;
+      c++;
+      continue;
+    }
+    if (*c == '/' && c + 1 < end && c[1] == '/')
+      break;
+    if (*c == ' ' || *c == '\t' || *c == '\r')
+      continue;
+    if (first && *c == '#')
+      directive = c;
+    first = false;
+  }
+  return directive != NULL;
+}
+
+// if the directive (up to end) is an include, sets name to the quoted file name
+static bool parseInclude(const char *line, const char *end, const char *&name, size_t &nameLength) {
+  if (end - line < 8 || strncmp(line, "#include", 8) != 0)
+    return false;
+  line += 8;
+
+  while (line < end && (*line == ' ' || *line == '\t'))
+    line++;
+  if (line == end || *line != '"')
+    return false;
+
+  const char *close = (const char *)memchr(line + 1, '"', end - line - 1);
+  if (close == NULL)
+    return false;
+  name = line + 1;
+  nameLength = close - name;
+  return true;
+}
+
+// if the directive (up to end) is #version, the preprocessor allows blanks after the '#'
+static bool isVersion(const char *directive, const char *end) {
+  directive++;
+  while (directive < end && (*directive == ' ' || *directive == '\t'))
+    directive++;
+  return end - directive >= 7 && strncmp(directive, "version", 7) == 0;
+}
+
+void ShaderSource::insertAfterVersion(const char *text, size_t length) {
+  // the first directive line that is #version, a "#version" in a comment before it does not count
+  bool inComment = false;
+  for (size_t i = 0; i < pieces.size(); i++) {
+    const char *begin = pieces[i], *end = pieces[i] + pieceLengths[i];
+    for (const char *line = begin; line < end;) {
+      const char *lineEnd = (const char *)memchr(line, '\n', end - line);
+      lineEnd = lineEnd ? lineEnd : end;
+
+      const char *directive;
+      if (!findDirective(line, lineEnd, inComment, directive) || !isVersion(directive, lineEnd)) {
+        line = lineEnd < end ? lineEnd + 1 : end;
+        continue;
+      }
+
+      if (lineEnd == end) {
+        // the version line closes the piece without a newline, the next piece starts on a new line anyway
+        pieces.insert(pieces.begin() + i + 1, text);
+        pieceLengths.insert(pieceLengths.begin() + i + 1, (GLint)length);
+        pieces.insert(pieces.begin() + i + 1, "\n");
+        pieceLengths.insert(pieceLengths.begin() + i + 1, 1);
+        return;
+      }
+
+      // split the piece behind the version line and put the text in between
+      GLint head = (GLint)(lineEnd + 1 - begin);
+      if (head < pieceLengths[i]) {
+        pieces.insert(pieces.begin() + i + 1, lineEnd + 1);
+        pieceLengths.insert(pieceLengths.begin() + i + 1, pieceLengths[i] - head);
+        pieceLengths[i] = head;
+      }
+      pieces.insert(pieces.begin() + i + 1, text);
+      pieceLengths.insert(pieceLengths.begin() + i + 1, (GLint)length);
+      return;
+    }
+  }
+
+  pieces.insert(pieces.begin(), text);
+  pieceLengths.insert(pieceLengths.begin(), (GLint)length);
+}
+
+bool ShaderSource::append(const std::string &path) {
+  for (size_t i = 0; i < includedPaths.size(); i++) {
+    if (includedPaths[i] == path)
+      return true;
+  }
+  includedPaths.push_back(path);
+
+  MappedFile *file = new MappedFile();
+  files.push_back(file);
+  if (!file->open(path.c_str())) {
+    std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ " << path << std::endl;
+    return false;
+  }
+
+  std::string directory = path.substr(0, path.find_last_of('/') + 1);
+  const char *text = (const char *)file->data;
+  const char *end = text + file->size;
+  const char *pieceStart = text;
+
+  // line by line, an include that is commented out is neither spliced in nor looked for
+  bool inComment = false;
+  for (const char *line = text; line < end;) {
+    const char *lineEnd = (const char *)memchr(line, '\n', end - line);
+    lineEnd = lineEnd ? lineEnd : end;
+
+    const char *directive, *name;
+    size_t nameLength;
+    if (findDirective(line, lineEnd, inComment, directive) && parseInclude(directive, lineEnd, name, nameLength)) {
+      // up to the directive, a comment closing before it on the same line stays
+      addPiece(pieceStart, directive - pieceStart);
+      if (!append(directory + std::string(name, nameLength)))
+        return false;
+      // the included file may not end with a newline, its last line must not run into ours
+      addPiece("\n", 1);
+      pieceStart = lineEnd < end ? lineEnd + 1 : end;
+    }
+
+    line = lineEnd < end ? lineEnd + 1 : end;
+  }
+  addPiece(pieceStart, end - pieceStart);
+
+  return true;
+}
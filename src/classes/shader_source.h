@@ -0,0 +1,60 @@
+#ifndef SHADER_SOURCE_H
+#define SHADER_SOURCE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+/*
+ A shader's source as a list of pieces pointing straight into memory mapped files, handed to glShaderSource with
+ explicit lengths so nothing is copied or NUL terminated. A line of the form
+   #include "file.glsl"
+ (relative to the including file) is replaced by the pieces of that file. Every file is included at most once,
+ which also makes include cycles harmless.
+*/
+class ShaderSource {
+public:
+  ShaderSource() {}
+  ~ShaderSource() { clear(); }
+
+  // maps path and everything it includes, false (with an error printed) if any file cannot be read
+  bool load(const char *path);
+  void clear();
+
+  // appends text owned by the caller, which must stay alive until the source is handed to a Shader
+  void addText(const char *text, size_t length) { addPiece(text, length); }
+
+  // appends the pieces of another source, which must stay loaded until this one is handed to a Shader
+  void addSource(const ShaderSource &other);
+
+  // inserts text right after the #version line (at the start if there is none), the only place #defines can go.
+  // Text inserted later lands in front of text inserted earlier
+  void insertAfterVersion(const char *text, size_t length);
+
+  // the arguments of glShaderSource
+  GLsizei count() const { return (GLsizei)pieces.size(); }
+  const GLchar *const *strings() const { return pieces.empty() ? NULL : &pieces[0]; }
+  const GLint *lengths() const { return pieceLengths.empty() ? NULL : &pieceLengths[0]; }
+
+  // FNV-1a over the stitched source, the same value as hashing one concatenated string
+  uint64_t hash(uint64_t seed = 14695981039346656037ull) const;
+
+private:
+  std::vector<MappedFile *> files;
+  std::vector<std::string> includedPaths;
+
+  std::vector<const GLchar *> pieces;
+  std::vector<GLint> pieceLengths;
+
+  bool append(const std::string &path);
+  void addPiece(const char *text, size_t length);
+
+  ShaderSource(const ShaderSource &);
+  ShaderSource &operator=(const ShaderSource &);
+};
+
+#endif
@@ -10,6 +10,8 @@
 #include <iostream>
 
 #include "../stb_image.h"
+#include "gl_state_cache.h"
+#include "texture_cache.h"
 
 class Texture {
 public:
@@ -20,24 +22,105 @@ public:
     stbi_set_flip_vertically_on_load(true);
     unsigned char *data = stbi_load(filename, &width, &height, &nrChannels, 0);
 
-    glGenTextures(1, &ID);
-    glBindTexture(GL_TEXTURE_2D, ID);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // texture wrapping in X axis
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // texture wrapping in Y axis
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST); // nearest mipmap level, linear filtering on mipmap level
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                // linear filtering when magnifiying
+    create();
 
     if (data) {
-      glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, colorScheme, GL_UNSIGNED_BYTE, data);
-      glGenerateMipmap(GL_TEXTURE_2D);
-
+      upload(data, width, height, colorScheme);
     } else {
       std::cout << "ERROR::TEXTURE::FAILED_TO_LOAD" << std::endl;
     }
 
     stbi_image_free(data);
   }
+
+  // loads the precompiled mip chain from the texture cache instead of decoding, converting the source on first use
+  Texture(const char *filename, bool useCache) {
+    create();
+
+    TextureCache cache;
+    if (useCache && cache.open(filename)) {
+      nrChannels = cache.hasAlpha() ? 4 : 3;
+      upload(cache);
+      return;
+    }
+
+    stbi_set_flip_vertically_on_load(true);
+    unsigned char *data = stbi_load(filename, &width, &height, &nrChannels, 0);
+    if (data) {
+      upload(data, width, height, nrChannels == 4 ? GL_RGBA : GL_RGB);
+    } else {
+      std::cout << "ERROR::TEXTURE::FAILED_TO_LOAD" << std::endl;
+    }
+    stbi_image_free(data);
+  }
+
+  // a 1x1 white placeholder, for textures whose pixels are still being decoded
+  Texture() {
+    create();
+
+    const unsigned char white[3] = {255, 255, 255};
+    nrChannels = 3;
+    upload(white, 1, 1, GL_RGB);
+  }
+
+  // replaces the texture storage. The name stays the same, so anything holding ID picks up the new pixels
+  void upload(const unsigned char *data, int w, int h, int colorScheme) {
+    width = w;
+    height = h;
+
+    uploadLevel(0, data, w, h, colorScheme);
+    setLevelCount(1000); // the GL default, glGenerateMipmap fills in the rest
+    glGenerateMipmap(GL_TEXTURE_2D);
+  }
+
+  // every level stored in the cache, nothing left to generate
+  void upload(const TextureCache &cache) {
+    const TextureCacheHeader &header = cache.header();
+    width = header.width;
+    height = header.height;
+
+    for (unsigned int i = 0; i < header.levelCount; i++) {
+      if (cache.compressed())
+        uploadCompressedLevel(i, cache.levelData(i), cache.level(i).width, cache.level(i).height, cache.colorScheme(), cache.level(i).size);
+      else
+        uploadLevel(i, cache.levelData(i), cache.level(i).width, cache.level(i).height, cache.colorScheme());
+    }
+    setLevelCount(header.levelCount);
+  }
+
+  void uploadLevel(int level, const unsigned char *data, int w, int h, int colorScheme) {
+    GLStateCache::bindTexture(ID);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // RGB rows are not always a multiple of 4 bytes
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGB, w, h, 0, colorScheme, GL_UNSIGNED_BYTE, data);
+  }
+
+  // already block compressed data, internalFormat one of the formats in block_compressor.h. The GPU samples it as is
+  void uploadCompressedLevel(int level, const unsigned char *data, int w, int h, GLenum internalFormat, size_t size) {
+    GLStateCache::bindTexture(ID);
+    glCompressedTexImage2D(GL_TEXTURE_2D, level, internalFormat, w, h, 0, (GLsizei)size, data);
+  }
+
+  // limits sampling to the levels that were actually uploaded
+  void setLevelCount(int levels) {
+    GLStateCache::bindTexture(ID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+  }
+
+  void destroy() {
+    GLStateCache::forgetTexture(ID);
+    glDeleteTextures(1, &ID);
+  }
+
+private:
+  void create() {
+    glGenTextures(1, &ID);
+    GLStateCache::bindTexture(ID);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT); // texture wrapping in X axis
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT); // texture wrapping in Y axis
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST); // nearest mipmap level, linear filtering on mipmap level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);                // linear filtering when magnifiying
+  }
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include <glad/glad.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "../stb_image.h"
+#include "texture_cache.h"
+
+static const uint32_t TEXCACHE_VERSION = 2;
+
+// tells apart the temporary files of conversions running at the same time
+static std::atomic<unsigned int> temporaryCounter(0);
+
+static size_t alignTo16(size_t value) { return (value + 15) & ~(size_t)15; }
+
+bool TextureCache::open(const char *sourcePath, const TextureCacheOptions &options) {
+  std::string path = cachePath(sourcePath);
+
+  if (file.open(path.c_str()) && validate(sourcePath, options)) {
+    // convert() reported it when the cache was written, a hit reports it from the header
+    if (compressed())
+      std::cout << "TEXTURE_CACHE::LOADED " << sourcePath << " " << blockFormatName(blockFormat()) << " PSNR " << header().psnr << " dB" << std::endl;
+    return true;
+  }
+  file.close();
+
+  if (!convert(sourcePath, path.c_str(), options))
+    return false;
+  return file.open(path.c_str()) && validate(sourcePath, options);
+}
+
+// whether convert() with these options could have written the format, BC1 is what any opaque image becomes
+static bool formatMatches(uint32_t format, const TextureCacheOptions &options) {
+  if (!options.compress)
+    return format == TEXCACHE_RGB8 || format == TEXCACHE_RGBA8;
+  return format == TEXCACHE_BC1 || format == (options.allowBC7 ? TEXCACHE_BC7 : TEXCACHE_BC3);
+}
+
+// bytes of a level as convert() writes it, 64 bit so no corrupt size wraps around
+static uint64_t levelSize(uint32_t format, BlockFormat blockFormat, uint64_t width, uint64_t height) {
+  if (format == TEXCACHE_RGB8 || format == TEXCACHE_RGBA8)
+    return width * height * (format == TEXCACHE_RGBA8 ? 4 : 3);
+  return ((width + 3) / 4) * ((height + 3) / 4) * blockBytes(blockFormat);
+}
+
+bool TextureCache::validate(const char *sourcePath, const TextureCacheOptions &options) {
+  if (file.size < sizeof(TextureCacheHeader))
+    return false;
+
+  const TextureCacheHeader &h = header();
+  if (memcmp(h.magic, "TXC1", 4) != 0 || h.version != TEXCACHE_VERSION || h.levelCount == 0)
+    return false;
+  if (!formatMatches(h.format, options))
+    return false;
+  if (sizeof(TextureCacheHeader) + h.levelCount * sizeof(TextureCacheLevel) > file.size)
+    return false;
+  // the levels are handed to GL as they are, a truncated or corrupt file must not make it read past the mapping
+  for (unsigned int i = 0; i < h.levelCount; i++) {
+    const TextureCacheLevel &entry = level(i);
+    if (entry.offset > file.size || entry.size > file.size - entry.offset)
+      return false;
+    if (entry.width == 0 || entry.height == 0 || entry.size != levelSize(h.format, blockFormat(), entry.width, entry.height))
+      return false;
+  }
+
+  int64_t mtime;
+  uint64_t size;
+  if (!fileStat(sourcePath, mtime, size))
+    return true; // shipped without its source, the cache is all there is
+
+  if (mtime == h.sourceMtime && size == h.sourceSize)
+    return true;
+  if (size != h.sourceSize)
+    return false;
+
+  // touched but maybe not changed, let the content decide
+  MappedFile source;
+  if (!source.open(sourcePath) || hashBytes(source.data, source.size) != h.sourceHash)
+    return false;
+
+  // remember the new mtime so the next start takes the fast path again
+  std::fstream patch(cachePath(sourcePath).c_str(), std::ios::in | std::ios::out | std::ios::binary);
+  patch.seekp(offsetof(TextureCacheHeader, sourceMtime));
+  patch.write((const char *)&mtime, sizeof(mtime));
+  return true;
+}
+
+// halves an image with a box filter, repeating the last row/column when a dimension is odd
+static void downsample(const unsigned char *src, int srcWidth, int srcHeight, unsigned char *dst, int dstWidth, int dstHeight, int channels) {
+  for (int y = 0; y < dstHeight; y++) {
+    int y0 = y * 2, y1 = y * 2 + 1 < srcHeight ? y * 2 + 1 : y * 2;
+    for (int x = 0; x < dstWidth; x++) {
+      int x0 = x * 2, x1 = x * 2 + 1 < srcWidth ? x * 2 + 1 : x * 2;
+      for (int c = 0; c < channels; c++) {
+        int sum = src[(y0 * srcWidth + x0) * channels + c] + src[(y0 * srcWidth + x1) * channels + c] + src[(y1 * srcWidth + x0) * channels + c] +
+                  src[(y1 * srcWidth + x1) * channels + c];
+        dst[(y * dstWidth + x) * channels + c] = (unsigned char)((sum + 2) / 4);
+      }
+    }
+  }
+}
+
+// true if every pixel of an RGBA image is fully opaque, so the alpha channel can be dropped
+static bool isOpaque(const std::vector<unsigned char> &pixels, int channels) {
+  if (channels != 4)
+    return true;
+  for (size_t i = 3; i < pixels.size(); i += 4) {
+    if (pixels[i] != 255)
+      return false;
+  }
+  return true;
+}
+
+bool TextureCache::convert(const char *sourcePath, const char *cachePath, const TextureCacheOptions &options) {
+  MappedFile source;
+  if (!source.open(sourcePath) || source.size == 0) {
+    std::cout << "ERROR::TEXTURE_CACHE::SOURCE_NOT_FOUND " << sourcePath << std::endl;
+    return false;
+  }
+
+  int width, height, channels;
+  if (!stbi_info_from_memory(source.data, (int)source.size, &width, &height, &channels)) {
+    std::cout << "ERROR::TEXTURE_CACHE::FAILED_TO_DECODE " << sourcePath << std::endl;
+    return false;
+  }
+  // grey and grey + alpha are expanded, so every cache is RGB or RGBA
+  channels = channels == 2 || channels == 4 ? 4 : 3;
+
+  stbi_set_flip_vertically_on_load_thread(true);
+  unsigned char *pixels = stbi_load_from_memory(source.data, (int)source.size, &width, &height, NULL, channels);
+  if (pixels == NULL) {
+    std::cout << "ERROR::TEXTURE_CACHE::FAILED_TO_DECODE " << sourcePath << std::endl;
+    return false;
+  }
+
+  TextureCacheHeader header;
+  memcpy(header.magic, "TXC1", 4);
+  header.version = TEXCACHE_VERSION;
+  header.sourceHash = hashBytes(source.data, source.size);
+  fileStat(sourcePath, header.sourceMtime, header.sourceSize);
+  header.width = width;
+  header.height = height;
+  header.format = channels == 4 ? TEXCACHE_RGBA8 : TEXCACHE_RGB8;
+  header.psnr = 0.0f;
+  memset(header.reserved, 0, sizeof(header.reserved));
+
+  // the full chain down to 1x1, the same levels glGenerateMipmap would make
+  std::vector<std::vector<unsigned char> > levels;
+  std::vector<TextureCacheLevel> table;
+  levels.push_back(std::vector<unsigned char>(pixels, pixels + (size_t)width * height * channels));
+  stbi_image_free(pixels);
+
+  int levelWidth = width, levelHeight = height;
+  while (true) {
+    TextureCacheLevel entry;
+    entry.width = levelWidth;
+    entry.height = levelHeight;
+    entry.size = levels.back().size();
+    entry.reserved = 0;
+    table.push_back(entry);
+
+    if (levelWidth == 1 && levelHeight == 1)
+      break;
+
+    int nextWidth = levelWidth > 1 ? levelWidth / 2 : 1;
+    int nextHeight = levelHeight > 1 ? levelHeight / 2 : 1;
+    std::vector<unsigned char> next((size_t)nextWidth * nextHeight * channels);
+    downsample(&levels.back()[0], levelWidth, levelHeight, &next[0], nextWidth, nextHeight, channels);
+    levels.push_back(next);
+    levelWidth = nextWidth;
+    levelHeight = nextHeight;
+  }
+  header.levelCount = (uint32_t)table.size();
+
+  if (options.compress) {
+    BlockFormat format = isOpaque(levels[0], channels) ? BLOCK_BC1 : (options.allowBC7 ? BLOCK_BC7 : BLOCK_BC3);
+    header.format = format == BLOCK_BC1 ? TEXCACHE_BC1 : (format == BLOCK_BC3 ? TEXCACHE_BC3 : TEXCACHE_BC7);
+
+    for (size_t i = 0; i < levels.size(); i++) {
+      std::vector<unsigned char> blocks(compressedSize(format, table[i].width, table[i].height));
+      compressImage(format, &levels[i][0], table[i].width, table[i].height, channels, &blocks[0]);
+
+      // the quality of the top level is what shows up close to the camera
+      if (i == 0) {
+        std::vector<unsigned char> decoded((size_t)width * height * 4);
+        decompressImage(format, &blocks[0], width, height, &decoded[0]);
+        header.psnr = (float)computePSNR(&levels[0][0], channels, &decoded[0], width, height);
+        std::cout << "TEXTURE_CACHE::COMPRESSED " << sourcePath << " " << blockFormatName(format) << " PSNR " << header.psnr << " dB" << std::endl;
+      }
+
+      levels[i].swap(blocks);
+      table[i].size = levels[i].size();
+    }
+  }
+
+  size_t offset = alignTo16(sizeof(TextureCacheHeader) + table.size() * sizeof(TextureCacheLevel));
+  for (size_t i = 0; i < table.size(); i++) {
+    table[i].offset = offset;
+    offset = alignTo16(offset + table[i].size);
+  }
+
+  // written next to the final name and renamed, so a reader never maps a half written file. Two workers (or two
+  // processes) converting the same source each write their own file, the last rename wins with a complete one
+  char suffix[48];
+  snprintf(suffix, sizeof(suffix), ".%ld.%u.tmp", (long)getpid(), temporaryCounter.fetch_add(1));
+  std::string temporary = std::string(cachePath) + suffix;
+  std::ofstream out(temporary.c_str(), std::ios::binary | std::ios::trunc);
+  out.write((const char *)&header, sizeof(header));
+  out.write((const char *)&table[0], table.size() * sizeof(TextureCacheLevel));
+
+  const char padding[16] = {0};
+  size_t written = sizeof(header) + table.size() * sizeof(TextureCacheLevel);
+  for (size_t i = 0; i < table.size(); i++) {
+    out.write(padding, table[i].offset - written);
+    out.write((const char *)&levels[i][0], table[i].size);
+    written = table[i].offset + table[i].size;
+  }
+  out.close();
+
+  if (!out || rename(temporary.c_str(), cachePath) != 0) {
+    std::cout << "ERROR::TEXTURE_CACHE::FAILED_TO_WRITE " << cachePath << std::endl;
+    remove(temporary.c_str());
+    return false;
+  }
+
+  std::cout << "TEXTURE_CACHE::CONVERTED " << sourcePath << " " << width << "x" << height << " " << table.size() << " LEVELS" << std::endl;
+  return true;
+}
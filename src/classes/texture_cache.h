@@ -0,0 +1,91 @@
+#ifndef TEXTURE_CACHE_H
+#define TEXTURE_CACHE_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+
+#include "block_compressor.h"
+#include "gl_extensions.h"
+#include "mapped_file.h"
+
+enum TextureCacheFormat { TEXCACHE_RGB8 = 0, TEXCACHE_RGBA8 = 1, TEXCACHE_BC1 = 2, TEXCACHE_BC3 = 3, TEXCACHE_BC7 = 4 };
+
+// what convert() may encode to. Workers cannot ask GL, so the options are read on the GL thread and passed along
+struct TextureCacheOptions {
+  bool compress; // BC1 for opaque images, BC3 for images with alpha
+  bool allowBC7; // BC7 instead of BC3 for images with alpha
+
+  TextureCacheOptions(bool compress = false, bool allowBC7 = false) : compress(compress), allowBC7(allowBC7) {}
+
+  // block compression as far as the current context supports it
+  static TextureCacheOptions compressed() { return TextureCacheOptions(GLExtensions::textureCompressionS3TC, GLExtensions::textureCompressionBPTC); }
+};
+
+/*
+ On-disk layout, little endian, everything 16 byte aligned:
+   TextureCacheHeader
+   TextureCacheLevel[levelCount]
+   pixel data of every level, tightly packed rows, bottom row first (already flipped for GL),
+   or for the BC formats the level's 4x4 blocks, row by row from the bottom
+*/
+struct TextureCacheHeader {
+  char magic[4]; // "TXC1"
+  uint32_t version;
+  uint64_t sourceHash; // FNV-1a of the source file
+  int64_t sourceMtime;
+  uint64_t sourceSize;
+  uint32_t width, height;
+  uint32_t format; // TextureCacheFormat
+  uint32_t levelCount;
+  float psnr; // dB of the compressed top level against the source, 0 for the uncompressed formats
+  uint32_t reserved[3];
+};
+
+struct TextureCacheLevel {
+  uint32_t width, height;
+  uint64_t offset; // from the start of the file
+  uint64_t size;
+  uint64_t reserved;
+};
+
+/*
+ A converted image with its whole mip chain, memory mapped so loading it costs about as much as reading the file.
+ The cache file sits next to its source ("container.png" -> "container.png.texcache") and is rebuilt when the
+ source changed: the size and mtime are checked first, and if those differ the source hash decides.
+*/
+class TextureCache {
+public:
+  // maps the cache of sourcePath, converting the source first if the cache is missing, stale or in a format the options rule out
+  bool open(const char *sourcePath, const TextureCacheOptions &options = TextureCacheOptions());
+  void close() { file.close(); }
+
+  const TextureCacheHeader &header() const { return *(const TextureCacheHeader *)file.data; }
+  const TextureCacheLevel &level(unsigned int i) const { return ((const TextureCacheLevel *)(file.data + sizeof(TextureCacheHeader)))[i]; }
+  const unsigned char *levelData(unsigned int i) const { return file.data + level(i).offset; }
+
+  bool compressed() const { return header().format >= TEXCACHE_BC1; }
+  BlockFormat blockFormat() const { return header().format == TEXCACHE_BC1 ? BLOCK_BC1 : (header().format == TEXCACHE_BC3 ? BLOCK_BC3 : BLOCK_BC7); }
+
+  // the matching format argument of glTexImage2D, or the internal format of glCompressedTexImage2D
+  GLenum colorScheme() const {
+    if (compressed())
+      return blockInternalFormat(blockFormat());
+    return header().format == TEXCACHE_RGBA8 ? GL_RGBA : GL_RGB;
+  }
+
+  bool hasAlpha() const { return header().format != TEXCACHE_RGB8 && header().format != TEXCACHE_BC1; }
+
+  static std::string cachePath(const char *sourcePath) { return std::string(sourcePath) + ".texcache"; }
+
+  // decodes sourcePath, builds the mip chain on the CPU, block compresses it if the options ask for it and writes the cache file
+  static bool convert(const char *sourcePath, const char *cachePath, const TextureCacheOptions &options = TextureCacheOptions());
+
+private:
+  MappedFile file;
+
+  bool validate(const char *sourcePath, const TextureCacheOptions &options);
+};
+
+#endif
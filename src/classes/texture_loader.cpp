@@ -0,0 +1,160 @@
+#include <glad/glad.h>
+
+#include <cstring>
+#include <iostream>
+
+#include "../stb_image.h"
+#include "texture_loader.h"
+
+TextureLoader::TextureLoader(unsigned int workerCount) : outstanding(0), uploadRing(NULL), stopping(false) {
+  if (workerCount == 0)
+    workerCount = std::thread::hardware_concurrency();
+  if (workerCount == 0)
+    workerCount = 2;
+
+  for (unsigned int i = 0; i < workerCount; i++)
+    workers.push_back(std::thread(&TextureLoader::workerLoop, this));
+}
+
+TextureLoader::~TextureLoader() {
+  {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    stopping = true;
+  }
+  jobsAvailable.notify_all();
+  for (size_t i = 0; i < workers.size(); i++)
+    workers[i].join();
+
+  // pixels decoded but never pumped
+  for (size_t i = 0; i < requests.size(); i++) {
+    stbi_image_free(requests[i]->pixels);
+    delete requests[i]->texture;
+    delete requests[i];
+  }
+}
+
+TextureHandle TextureLoader::load(const char *filename, bool useCache, bool compress) {
+  TextureRequest *request = new TextureRequest();
+  request->filename = filename;
+  request->useCache = useCache || compress;
+  if (compress)
+    request->cacheOptions = TextureCacheOptions::compressed();
+  request->texture = new Texture();
+  requests.push_back(request);
+  outstanding++;
+
+  {
+    std::lock_guard<std::mutex> lock(jobsMutex);
+    jobs.push_back(request);
+  }
+  jobsAvailable.notify_one();
+
+  return TextureHandle(request);
+}
+
+void TextureLoader::workerLoop() {
+  // stb_image keeps the flag per thread when built with thread locals, the global setter would race between workers
+  stbi_set_flip_vertically_on_load_thread(true);
+
+  while (true) {
+    TextureRequest *request;
+    {
+      std::unique_lock<std::mutex> lock(jobsMutex);
+      while (jobs.empty() && !stopping)
+        jobsAvailable.wait(lock);
+      if (stopping)
+        return;
+      request = jobs.front();
+      jobs.pop_front();
+    }
+
+    bool loaded;
+    if (request->useCache) {
+      // converting a missing or stale cache happens right here, on the worker
+      loaded = request->cache.open(request->filename.c_str(), request->cacheOptions);
+    } else {
+      // grey and grey + alpha are expanded to RGB and RGBA, the only layouts Texture uploads
+      int channels = 3;
+      if (stbi_info(request->filename.c_str(), &request->width, &request->height, &channels))
+        request->channels = channels == 2 || channels == 4 ? 4 : 3;
+      request->pixels = stbi_load(request->filename.c_str(), &request->width, &request->height, NULL, request->channels);
+      loaded = request->pixels != NULL;
+    }
+    request->state.store(loaded ? TEXTURE_DECODED : TEXTURE_FAILED, std::memory_order_release);
+    decoded.push(request);
+  }
+}
+
+unsigned int TextureLoader::pump(unsigned int maxUploads) {
+  unsigned int uploads = 0;
+
+  while (uploads < maxUploads) {
+    TextureRequest *request = decoded.pop();
+    if (request == NULL)
+      break;
+    outstanding--;
+
+    if (request->state.load(std::memory_order_acquire) == TEXTURE_FAILED) {
+      std::cout << "ERROR::TEXTURE::FAILED_TO_LOAD " << request->filename << std::endl;
+      continue;
+    }
+
+    if (request->useCache) {
+      const TextureCache &cache = request->cache;
+      request->texture->nrChannels = cache.hasAlpha() ? 4 : 3;
+      request->texture->width = cache.header().width;
+      request->texture->height = cache.header().height;
+
+      for (unsigned int i = 0; i < cache.header().levelCount; i++) {
+        const TextureCacheLevel &level = cache.level(i);
+        uploadLevel(request->texture, i, cache.levelData(i), level.width, level.height, cache.colorScheme(), level.size, cache.compressed());
+      }
+      request->texture->setLevelCount(cache.header().levelCount);
+      request->cache.close();
+    } else {
+      GLenum colorScheme = request->channels == 4 ? GL_RGBA : GL_RGB;
+      request->texture->nrChannels = request->channels;
+      request->texture->width = request->width;
+      request->texture->height = request->height;
+
+      uploadLevel(request->texture, 0, request->pixels, request->width, request->height, colorScheme, (size_t)request->width * request->height * request->channels, false);
+      request->texture->setLevelCount(1000);
+      glGenerateMipmap(GL_TEXTURE_2D);
+    }
+    request->state.store(TEXTURE_READY, std::memory_order_release);
+
+    stbi_image_free(request->pixels);
+    request->pixels = NULL;
+    uploads++;
+  }
+
+  return uploads;
+}
+
+// colorScheme is the internal format when compressed
+void TextureLoader::uploadLevel(Texture *texture, int level, const unsigned char *pixels, int width, int height, GLenum colorScheme, size_t size, bool compressed) {
+  PixelUploadSlot slot;
+  slot.memory = NULL;
+  if (uploadRing)
+    slot = uploadRing->acquire(size);
+
+  const unsigned char *source = pixels;
+  if (slot.memory != NULL) {
+    memcpy(slot.memory, pixels, size);
+    uploadRing->beginUpload(slot);
+    source = slot.offset;
+  }
+
+  if (compressed)
+    texture->uploadCompressedLevel(level, source, width, height, colorScheme, size);
+  else
+    texture->uploadLevel(level, source, width, height, colorScheme);
+
+  if (slot.memory != NULL)
+    uploadRing->endUpload(slot);
+}
+
+void TextureLoader::destroy() {
+  for (size_t i = 0; i < requests.size(); i++)
+    requests[i]->texture->destroy();
+}
@@ -0,0 +1,101 @@
+#ifndef TEXTURE_LOADER_H
+#define TEXTURE_LOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mpsc_queue.hpp"
+#include "pixel_upload_ring.h"
+#include "texture.hpp"
+#include "texture_cache.h"
+
+enum TextureState { TEXTURE_PENDING, TEXTURE_DECODED, TEXTURE_READY, TEXTURE_FAILED };
+
+struct TextureRequest {
+  std::string filename;
+  Texture *texture; // placeholder until the decoded pixels are uploaded
+  bool useCache;
+  TextureCacheOptions cacheOptions;
+
+  // written by the worker that decoded the file
+  unsigned char *pixels;
+  int width, height, channels;
+
+  // or, when useCache is set, the mapped mip chain
+  TextureCache cache;
+
+  std::atomic<int> state;
+  std::atomic<TextureRequest *> next; // link for the decoded queue
+
+  TextureRequest() : texture(NULL), useCache(false), pixels(NULL), width(0), height(0), channels(0), state(TEXTURE_PENDING), next(NULL) {}
+};
+
+// What load() hands out. The texture name is valid right away, its pixels arrive with a later pump()
+class TextureHandle {
+public:
+  TextureHandle(TextureRequest *request = NULL) : request(request) {}
+
+  // 0, GL's "no texture", for a handle that was never loaded
+  unsigned int id() const { return request != NULL ? request->texture->ID : 0; }
+  // loaded handles only
+  Texture &texture() const { return *request->texture; }
+
+  // a handle that was never loaded will not become ready, so it reports TEXTURE_FAILED rather than TEXTURE_PENDING
+  TextureState state() const { return request != NULL ? (TextureState)request->state.load(std::memory_order_acquire) : TEXTURE_FAILED; }
+  bool ready() const { return state() == TEXTURE_READY; }
+
+private:
+  TextureRequest *request;
+};
+
+/*
+ Decodes images on a pool of worker threads, so only the upload happens on the GL thread.
+ Workers take requests from a mutex protected list (they sleep while it is empty) and hand the decoded
+ pixels back through a lock-free queue, which pump() drains from the render loop without ever blocking.
+*/
+class TextureLoader {
+public:
+  // 0 workers means one per hardware thread
+  TextureLoader(unsigned int workerCount = 0);
+  ~TextureLoader();
+
+  // GL thread only: creates a placeholder texture and queues the file for decoding.
+  // With useCache the worker maps the precompiled mip chain instead, converting the source if needed.
+  // compress block compresses that chain when the context can sample it, and implies useCache
+  TextureHandle load(const char *filename, bool useCache = false, bool compress = false);
+
+  // GL thread only: uploads up to maxUploads decoded images, returns how many were uploaded
+  unsigned int pump(unsigned int maxUploads = ~0u);
+
+  // stage uploads through a ring of pixel buffers instead of uploading from client memory, NULL to turn it off
+  void setUploadRing(PixelUploadRing *ring) { uploadRing = ring; }
+
+  // true once every requested texture was uploaded (or failed)
+  bool idle() const { return outstanding == 0; }
+
+  // GL thread only: deletes every texture handed out
+  void destroy();
+
+private:
+  std::vector<std::thread> workers;
+  std::vector<TextureRequest *> requests;
+  unsigned int outstanding;
+  PixelUploadRing *uploadRing;
+
+  std::mutex jobsMutex;
+  std::condition_variable jobsAvailable;
+  std::deque<TextureRequest *> jobs;
+  bool stopping;
+
+  MPSCQueue<TextureRequest> decoded;
+
+  void workerLoop();
+  void uploadLevel(Texture *texture, int level, const unsigned char *pixels, int width, int height, GLenum colorScheme, size_t size, bool compressed);
+};
+
+#endif
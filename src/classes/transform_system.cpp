@@ -0,0 +1,142 @@
+#include "transform_system.h"
+#include "job_system.h"
+
+// below this many dirty entities in a word of the bitset, building the marked ones one by one beats building all 64
+static const int BLOCK_THRESHOLD = 16;
+
+// dirty words per job, and how many there have to be before update() hands them to a JobSystem at all
+static const uint32_t WORDS_PER_JOB = 64;
+static const size_t PARALLEL_WORDS = 2 * WORDS_PER_JOB;
+
+uint32_t TransformSystem::create(const glm::vec3 &position, const glm::quat &rotation, const glm::vec3 &scale) {
+  uint32_t entity = (uint32_t)size();
+  positionX.push_back(position.x);
+  positionY.push_back(position.y);
+  positionZ.push_back(position.z);
+  rotationX.push_back(rotation.x);
+  rotationY.push_back(rotation.y);
+  rotationZ.push_back(rotation.z);
+  rotationW.push_back(rotation.w);
+  scaleX.push_back(scale.x);
+  scaleY.push_back(scale.y);
+  scaleZ.push_back(scale.z);
+  world.push_back(glm::mat4(1.0f));
+
+  if ((entity & 63) == 0)
+    dirtyBits.push_back(0);
+  markDirty(entity);
+  return entity;
+}
+
+void TransformSystem::setPosition(uint32_t entity, const glm::vec3 &position) {
+  positionX[entity] = position.x;
+  positionY[entity] = position.y;
+  positionZ[entity] = position.z;
+  markDirty(entity);
+}
+
+void TransformSystem::setRotation(uint32_t entity, const glm::quat &rotation) {
+  rotationX[entity] = rotation.x;
+  rotationY[entity] = rotation.y;
+  rotationZ[entity] = rotation.z;
+  rotationW[entity] = rotation.w;
+  markDirty(entity);
+}
+
+void TransformSystem::setScale(uint32_t entity, const glm::vec3 &scale) {
+  scaleX[entity] = scale.x;
+  scaleY[entity] = scale.y;
+  scaleZ[entity] = scale.z;
+  markDirty(entity);
+}
+
+size_t TransformSystem::update(uint32_t *changed, JobSystem *jobs) {
+  // take the dirty words out of the bitset first, after that any thread can build any of them
+  size_t count = 0;
+  dirtyWords.clear();
+  for (size_t word = 0; word < dirtyBits.size(); word++) {
+    uint64_t bits = dirtyBits[word];
+    if (bits == 0)
+      continue;
+    dirtyBits[word] = 0;
+
+    DirtyWord dirty = {(uint32_t)(word << 6), bits};
+    dirtyWords.push_back(dirty);
+    for (; bits != 0; bits &= bits - 1) {
+      if (changed != NULL)
+        changed[count] = dirty.first + __builtin_ctzll(bits);
+      count++;
+    }
+  }
+
+  if (jobs != NULL && dirtyWords.size() >= PARALLEL_WORDS) {
+    jobs->parallelFor((uint32_t)dirtyWords.size(), WORDS_PER_JOB, [this](uint32_t begin, uint32_t end) {
+      for (uint32_t i = begin; i < end; i++)
+        computeWord(dirtyWords[i]);
+    });
+  } else {
+    for (size_t i = 0; i < dirtyWords.size(); i++)
+      computeWord(dirtyWords[i]);
+  }
+  return count;
+}
+
+void TransformSystem::computeWord(const DirtyWord &word) {
+  // the last word may be partly past the end of the arrays, it always goes one by one
+  if (__builtin_popcountll(word.bits) >= BLOCK_THRESHOLD && word.first + 64 <= size()) {
+    computeBlock(word.first, word.bits);
+  } else {
+    for (uint64_t bits = word.bits; bits != 0; bits &= bits - 1)
+      computeOne(word.first + __builtin_ctzll(bits));
+  }
+}
+
+/*
+ The rotation matrix of a unit quaternion (x, y, z, w), each column scaled by the matching scale component, with the
+ position as the last column: the same matrix as translate(position) * mat4_cast(rotation) * scale(scale).
+*/
+void TransformSystem::computeOne(uint32_t entity) {
+  float x = rotationX[entity], y = rotationY[entity], z = rotationZ[entity], w = rotationW[entity];
+  float sx = scaleX[entity], sy = scaleY[entity], sz = scaleZ[entity];
+
+  glm::mat4 &m = world[entity];
+  m[0] = glm::vec4((1.0f - 2.0f * (y * y + z * z)) * sx, 2.0f * (x * y + w * z) * sx, 2.0f * (x * z - w * y) * sx, 0.0f);
+  m[1] = glm::vec4(2.0f * (x * y - w * z) * sy, (1.0f - 2.0f * (x * x + z * z)) * sy, 2.0f * (y * z + w * x) * sy, 0.0f);
+  m[2] = glm::vec4(2.0f * (x * z + w * y) * sz, 2.0f * (y * z - w * x) * sz, (1.0f - 2.0f * (x * x + y * y)) * sz, 0.0f);
+  m[3] = glm::vec4(positionX[entity], positionY[entity], positionZ[entity], 1.0f);
+}
+
+// the same formula for all 64 entities of a word of the bitset at once
+void TransformSystem::computeBlock(uint32_t first, uint64_t bits) {
+  const float *x = &rotationX[first], *y = &rotationY[first], *z = &rotationZ[first], *w = &rotationW[first];
+  const float *sx = &scaleX[first], *sy = &scaleY[first], *sz = &scaleZ[first];
+
+  // the nine rotation-scale terms go to arrays of their own first: this loop only reads and writes contiguous floats,
+  // which the compiler turns into SIMD code (a fixed trip count lets it do so at -O2 too). Clean entities in the word are
+  // built as well, that is cheaper than branching
+  float m00[64], m01[64], m02[64], m10[64], m11[64], m12[64], m20[64], m21[64], m22[64];
+  for (uint32_t i = 0; i < 64; i++) {
+    float xx = x[i] * x[i], yy = y[i] * y[i], zz = z[i] * z[i];
+    float xy = x[i] * y[i], xz = x[i] * z[i], yz = y[i] * z[i];
+    float wx = w[i] * x[i], wy = w[i] * y[i], wz = w[i] * z[i];
+    m00[i] = (1.0f - 2.0f * (yy + zz)) * sx[i];
+    m01[i] = 2.0f * (xy + wz) * sx[i];
+    m02[i] = 2.0f * (xz - wy) * sx[i];
+    m10[i] = 2.0f * (xy - wz) * sy[i];
+    m11[i] = (1.0f - 2.0f * (xx + zz)) * sy[i];
+    m12[i] = 2.0f * (yz + wx) * sy[i];
+    m20[i] = 2.0f * (xz + wy) * sz[i];
+    m21[i] = 2.0f * (yz - wx) * sz[i];
+    m22[i] = (1.0f - 2.0f * (xx + yy)) * sz[i];
+  }
+
+  // back to one column major matrix per entity, only for the ones that changed
+  for (; bits != 0; bits &= bits - 1) {
+    uint32_t i = __builtin_ctzll(bits);
+    glm::mat4 &m = world[first + i];
+    m[0] = glm::vec4(m00[i], m01[i], m02[i], 0.0f);
+    m[1] = glm::vec4(m10[i], m11[i], m12[i], 0.0f);
+    m[2] = glm::vec4(m20[i], m21[i], m22[i], 0.0f);
+    m[3] = glm::vec4(positionX[first + i], positionY[first + i], positionZ[first + i], 1.0f);
+  }
+}
@@ -0,0 +1,63 @@
+#ifndef TRANSFORM_SYSTEM_H
+#define TRANSFORM_SYSTEM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <vector>
+
+class JobSystem;
+
+/*
+ Position, rotation and scale of every entity, one contiguous array per component, and the world matrices built from
+ them. Setters only mark the entity in a dirty bitset; update() rebuilds the matrices of the marked entities, so a
+ scene that stands still costs a scan of the bitset and nothing else.
+ world is laid out like the instance buffer (one column major mat4 per entity), so a renderer can copy from it as is.
+*/
+class TransformSystem {
+public:
+  std::vector<float> positionX, positionY, positionZ;
+  std::vector<float> rotationX, rotationY, rotationZ, rotationW; // unit quaternions
+  std::vector<float> scaleX, scaleY, scaleZ;
+  std::vector<glm::mat4> world; // translate * rotate * scale, valid for every entity after update()
+
+  // returns the new entity, dirty until the next update()
+  uint32_t create(const glm::vec3 &position, const glm::quat &rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3 &scale = glm::vec3(1.0f));
+  size_t size() const { return positionX.size(); }
+
+  glm::vec3 position(uint32_t entity) const { return glm::vec3(positionX[entity], positionY[entity], positionZ[entity]); }
+  glm::quat rotation(uint32_t entity) const { return glm::quat(rotationW[entity], rotationX[entity], rotationY[entity], rotationZ[entity]); }
+  glm::vec3 scale(uint32_t entity) const { return glm::vec3(scaleX[entity], scaleY[entity], scaleZ[entity]); }
+
+  void setPosition(uint32_t entity, const glm::vec3 &position);
+  void setRotation(uint32_t entity, const glm::quat &rotation);
+  void setScale(uint32_t entity, const glm::vec3 &scale);
+
+  // for code writing the component arrays directly. 64 entities share a word of the bitset, threads marking entities in
+  // parallel have to split the range at multiples of 64
+  void markDirty(uint32_t entity) { dirtyBits[entity >> 6] |= 1ull << (entity & 63); }
+  bool isDirty(uint32_t entity) const { return (dirtyBits[entity >> 6] >> (entity & 63)) & 1; }
+
+  /*
+   Rebuilds the world matrix of every dirty entity and clears the bitset. Returns how many were rebuilt and, when
+   changed is given (room for size() entries), writes their indices to it in increasing order: what a BVH refit or a
+   partial buffer upload needs. With jobs, the words of the bitset are spread over its threads once there are enough.
+  */
+  size_t update(uint32_t *changed = NULL, JobSystem *jobs = NULL);
+
+private:
+  struct DirtyWord {
+    uint32_t first; // entity of bit 0
+    uint64_t bits;
+  };
+
+  std::vector<uint64_t> dirtyBits; // one bit per entity, 64 entities per word
+  std::vector<DirtyWord> dirtyWords; // taken from dirtyBits by update(), reused between calls
+
+  void computeWord(const DirtyWord &word);
+  void computeBlock(uint32_t first, uint64_t bits);
+  void computeOne(uint32_t entity);
+};
+
+#endif
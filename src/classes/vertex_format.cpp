@@ -0,0 +1,205 @@
+#include <glad/glad.h>
+
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <iomanip>
+#include <iostream>
+
+#include "vertex_format.h"
+
+unsigned int encodingSize(VertexEncoding encoding) { return encoding == ENCODING_FLOAT32 ? 4 : 2; }
+
+const char *encodingName(VertexEncoding encoding) {
+  switch (encoding) {
+  case ENCODING_FLOAT32:
+    return "FLOAT32";
+  case ENCODING_HALF:
+    return "HALF_FLOAT";
+  case ENCODING_SNORM16:
+    return "SNORM16";
+  case ENCODING_UNORM16:
+    return "UNORM16";
+  }
+  return "UNKNOWN";
+}
+
+static GLenum encodingType(VertexEncoding encoding) {
+  switch (encoding) {
+  case ENCODING_HALF:
+    return GL_HALF_FLOAT;
+  case ENCODING_SNORM16:
+    return GL_SHORT;
+  case ENCODING_UNORM16:
+    return GL_UNSIGNED_SHORT;
+  default:
+    return GL_FLOAT;
+  }
+}
+
+static bool isNormalized(VertexEncoding encoding) { return encoding == ENCODING_SNORM16 || encoding == ENCODING_UNORM16; }
+
+// fits scale/bias so the attribute's range maps onto the full range of the normalized encoding
+static void fitScaleBias(VertexEncoding encoding, const float *vertices, size_t vertexCount, unsigned int sourceStride, unsigned int sourceOffset,
+                         unsigned int components, glm::vec4 &scale, glm::vec4 &bias) {
+  scale = glm::vec4(1.0f);
+  bias = glm::vec4(0.0f);
+  if (!isNormalized(encoding) || vertexCount == 0)
+    return;
+
+  for (unsigned int c = 0; c < components; c++) {
+    float lo = vertices[sourceOffset + c], hi = lo;
+    for (size_t v = 1; v < vertexCount; v++) {
+      float value = vertices[v * sourceStride + sourceOffset + c];
+      lo = value < lo ? value : lo;
+      hi = value > hi ? value : hi;
+    }
+
+    float range = hi - lo;
+    if (range == 0.0f)
+      range = 1.0f;
+
+    if (encoding == ENCODING_SNORM16) {
+      bias[c] = (lo + hi) * 0.5f;
+      scale[c] = range * 0.5f;
+    } else {
+      bias[c] = lo;
+      scale[c] = range;
+    }
+  }
+}
+
+static uint16_t encodeComponent(VertexEncoding encoding, float value, float scale, float bias) {
+  switch (encoding) {
+  case ENCODING_HALF:
+    return glm::packHalf1x16(value);
+  case ENCODING_SNORM16:
+    return glm::packSnorm1x16((value - bias) / scale);
+  default:
+    return glm::packUnorm1x16((value - bias) / scale);
+  }
+}
+
+// what the vertex shader ends up seeing. Signed values use the c / 32767 rule drivers apply today, not GL 3.3's (2c + 1) / 65535
+static float decodeComponent(VertexEncoding encoding, uint16_t encoded, float scale, float bias) {
+  switch (encoding) {
+  case ENCODING_HALF:
+    return glm::unpackHalf1x16(encoded);
+  case ENCODING_SNORM16:
+    return glm::unpackSnorm1x16(encoded) * scale + bias;
+  default:
+    return glm::unpackUnorm1x16(encoded) * scale + bias;
+  }
+}
+
+void VertexFormat::add(unsigned int location, unsigned int components, VertexEncoding encoding) {
+  VertexAttribute attribute;
+  attribute.location = location;
+  attribute.components = components;
+  attribute.encoding = encoding;
+  attribute.offset = stride;
+  attribute.scale = glm::vec4(1.0f);
+  attribute.bias = glm::vec4(0.0f);
+  attributes.push_back(attribute);
+
+  stride += (components * encodingSize(encoding) + 3) & ~3u;
+}
+
+unsigned int VertexFormat::sourceFloats() const {
+  unsigned int floats = 0;
+  for (size_t i = 0; i < attributes.size(); i++)
+    floats += attributes[i].components;
+  return floats;
+}
+
+std::vector<unsigned char> VertexFormat::pack(const float *vertices, size_t vertexCount) {
+  std::vector<unsigned char> packed(vertexCount * stride, 0);
+  unsigned int sourceStride = sourceFloats();
+  unsigned int sourceOffset = 0;
+
+  for (size_t i = 0; i < attributes.size(); i++) {
+    VertexAttribute &attribute = attributes[i];
+    fitScaleBias(attribute.encoding, vertices, vertexCount, sourceStride, sourceOffset, attribute.components, attribute.scale, attribute.bias);
+
+    for (size_t v = 0; v < vertexCount; v++) {
+      const float *source = vertices + v * sourceStride + sourceOffset;
+      unsigned char *destination = &packed[v * stride + attribute.offset];
+
+      if (attribute.encoding == ENCODING_FLOAT32) {
+        memcpy(destination, source, attribute.components * sizeof(float));
+        continue;
+      }
+
+      for (unsigned int c = 0; c < attribute.components; c++) {
+        uint16_t encoded = encodeComponent(attribute.encoding, source[c], attribute.scale[c], attribute.bias[c]);
+        memcpy(destination + c * sizeof(uint16_t), &encoded, sizeof(uint16_t));
+      }
+    }
+
+    sourceOffset += attribute.components;
+  }
+
+  return packed;
+}
+
+void VertexFormat::apply() const {
+  for (size_t i = 0; i < attributes.size(); i++) {
+    const VertexAttribute &attribute = attributes[i];
+    glVertexAttribPointer(attribute.location, attribute.components, encodingType(attribute.encoding), isNormalized(attribute.encoding) ? GL_TRUE : GL_FALSE,
+                          stride, (void *)(size_t)attribute.offset);
+    glEnableVertexAttribArray(attribute.location);
+  }
+}
+
+VertexFormat chooseVertexFormat(const char *name, const float *vertices, size_t vertexCount, const unsigned int *locations, const unsigned int *components,
+                                const float *tolerances, unsigned int attributeCount) {
+  const VertexEncoding candidates[] = {ENCODING_HALF, ENCODING_SNORM16, ENCODING_UNORM16};
+
+  unsigned int sourceStride = 0;
+  for (unsigned int i = 0; i < attributeCount; i++)
+    sourceStride += components[i];
+
+  VertexFormat format;
+  unsigned int sourceOffset = 0;
+
+  for (unsigned int i = 0; i < attributeCount; i++) {
+    VertexEncoding best = ENCODING_FLOAT32;
+    float bestError = 0.0f;
+
+    for (unsigned int e = 0; e < 3; e++) {
+      VertexEncoding encoding = candidates[e];
+      glm::vec4 scale, bias;
+      fitScaleBias(encoding, vertices, vertexCount, sourceStride, sourceOffset, components[i], scale, bias);
+
+      float maxError = 0.0f;
+      double squaredError = 0.0;
+      for (size_t v = 0; v < vertexCount; v++) {
+        for (unsigned int c = 0; c < components[i]; c++) {
+          float value = vertices[v * sourceStride + sourceOffset + c];
+          float decoded = decodeComponent(encoding, encodeComponent(encoding, value, scale[c], bias[c]), scale[c], bias[c]);
+          float error = fabsf(decoded - value);
+          maxError = error > maxError ? error : maxError;
+          squaredError += (double)error * error;
+        }
+      }
+      double rms = vertexCount ? sqrt(squaredError / (double)(vertexCount * components[i])) : 0.0;
+
+      std::cout << "VERTEX_FORMAT::" << name << " LOCATION " << locations[i] << " " << encodingName(encoding) << std::scientific << std::setprecision(3)
+                << " MAX_ERROR " << maxError << " RMS " << rms << std::defaultfloat << std::endl;
+
+      // on ties the earlier candidate wins, half floats need no dequantization
+      if (maxError <= tolerances[i] && (best == ENCODING_FLOAT32 || maxError < bestError)) {
+        best = encoding;
+        bestError = maxError;
+      }
+    }
+
+    format.add(locations[i], components[i], best);
+    std::cout << "VERTEX_FORMAT::" << name << " LOCATION " << locations[i] << " USING " << encodingName(best) << std::endl;
+
+    sourceOffset += components[i];
+  }
+
+  std::cout << "VERTEX_FORMAT::" << name << " STRIDE " << sourceStride * sizeof(float) << " -> " << format.stride << " BYTES" << std::endl;
+  return format;
+}
@@ -0,0 +1,64 @@
+#ifndef VERTEX_FORMAT_H
+#define VERTEX_FORMAT_H
+
+#include <glad/glad.h>
+
+#include <cstddef>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// How one attribute is stored in the vertex buffer
+enum VertexEncoding {
+  ENCODING_FLOAT32, // GL_FLOAT
+  ENCODING_HALF,    // GL_HALF_FLOAT
+  ENCODING_SNORM16, // GL_SHORT normalized, value = encoded * scale + bias
+  ENCODING_UNORM16  // GL_UNSIGNED_SHORT normalized, value = encoded * scale + bias
+};
+
+struct VertexAttribute {
+  unsigned int location;
+  unsigned int components;
+  VertexEncoding encoding;
+  unsigned int offset; // in bytes, inside the packed vertex
+
+  // dequantization applied by the vertex shader, identity for float encodings
+  glm::vec4 scale;
+  glm::vec4 bias;
+};
+
+// Describes a packed vertex. Attributes are read in order from an interleaved float source,
+// each one consuming `components` floats
+class VertexFormat {
+public:
+  std::vector<VertexAttribute> attributes;
+  unsigned int stride;
+
+  VertexFormat() : stride(0) {}
+
+  // appends an attribute, keeping every attribute 4 byte aligned as GL prefers
+  void add(unsigned int location, unsigned int components, VertexEncoding encoding);
+
+  // floats per vertex of the unpacked source
+  unsigned int sourceFloats() const;
+
+  // packs an interleaved float source, fitting scale/bias of the normalized attributes to the data
+  std::vector<unsigned char> pack(const float *vertices, size_t vertexCount);
+
+  // issues glVertexAttribPointer + glEnableVertexAttribArray for every attribute, for the bound VAO and GL_ARRAY_BUFFER
+  void apply() const;
+};
+
+// size in bytes of one component
+unsigned int encodingSize(VertexEncoding encoding);
+const char *encodingName(VertexEncoding encoding);
+
+/*
+ Packs every attribute of the source with each 16 bit encoding, measures the round trip error and prints it.
+ Picks, per attribute, the 16 bit encoding with the smallest maximum error, falling back to 32 bit floats when
+ even that one is above the tolerance (absolute, in the attribute's own units).
+*/
+VertexFormat chooseVertexFormat(const char *name, const float *vertices, size_t vertexCount, const unsigned int *locations, const unsigned int *components,
+                                const float *tolerances, unsigned int attributeCount);
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef WORK_STEALING_DEQUE_H
+#define WORK_STEALING_DEQUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+/*
+ Lock-free work-stealing deque (Chase and Lev, with the memory orderings of Le et al. for weak memory models).
+ The owning thread pushes and pops at the bottom, like a stack, so it keeps working on what it just split off while
+ it is still in its cache. Any other thread steals the oldest item from the top, which is usually the largest piece
+ of work left. The capacity is fixed: push() returns false when it is full and the caller runs the item itself.
+ T has to be a pointer, NULL means empty (or a lost race).
+*/
+template <typename T, size_t CAPACITY = 4096> class WorkStealingDeque {
+public:
+  WorkStealingDeque() : top(0), bottom(0) {
+    for (size_t i = 0; i < CAPACITY; i++)
+      buffer[i].store(NULL, std::memory_order_relaxed);
+  }
+
+  // owner only
+  bool push(T item) {
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t >= (int64_t)CAPACITY)
+      return false;
+
+    // the release store publishes the item, and whatever it points to, to a thief that reads bottom with acquire
+    buffer[b & MASK].store(item, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+  }
+
+  // owner only
+  T pop() {
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b) {
+      // was already empty
+      bottom.store(b + 1, std::memory_order_relaxed);
+      return NULL;
+    }
+
+    T item = buffer[b & MASK].load(std::memory_order_relaxed);
+    if (t == b) {
+      // the last item, a thief may be taking it at the same time: whoever moves top first gets it
+      if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        item = NULL;
+      bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return item;
+  }
+
+  // any thread
+  T steal() {
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+      return NULL;
+
+    T item = buffer[t & MASK].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+      return NULL;
+    return item;
+  }
+
+  // owner only: exact for the owner, thieves can only make room, so a push right after a false full() succeeds
+  bool full() const { return bottom.load(std::memory_order_relaxed) - top.load(std::memory_order_acquire) >= (int64_t)CAPACITY; }
+
+  // a snapshot, only a hint while other threads work on the deque
+  bool empty() const { return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed); }
+
+private:
+  static const int64_t MASK = (int64_t)CAPACITY - 1;
+  static_assert((CAPACITY & (CAPACITY - 1)) == 0, "WorkStealingDeque capacity must be a power of two");
+
+  // top is written by thieves and bottom by the owner, the padding keeps them from sharing a cache line
+  std::atomic<int64_t> top;
+  char padding[64 - sizeof(std::atomic<int64_t>)];
+  std::atomic<int64_t> bottom;
+  std::atomic<T> buffer[CAPACITY];
+
+  WorkStealingDeque(const WorkStealingDeque &);
+  WorkStealingDeque &operator=(const WorkStealingDeque &);
+};
+
+#endif
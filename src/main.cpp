@@ -2,119 +2,255 @@
 
 #include <GLFW/glfw3.h>
 #include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <glm/glm.hpp>
 #include <iostream>
+#include <string>
 
+#include "classes/bvh.h"
 #include "classes/camera.hpp"
-#include "classes/shader.h"
-#include "classes/texture.hpp"
+#include "classes/cube_scene.h"
+#include "classes/frame_capture.h"
+#include "classes/gl_extensions.h"
+#include "classes/headless_context.h"
+#include "classes/job_system.h"
+#include "classes/profiler.h"
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/fwd.hpp"
-#include "models/cube_model.hpp"
 #include "stb_image.h"
 #include "util.h"
 
 void framebufferSizeCallback(GLFWwindow *window, int width, int height);
 void mouseCallback(GLFWwindow *window, double xpos, double ypos);
 void scrollCallback(GLFWwindow *window, double xoffset, double yoffset);
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods);
 void processInput(GLFWwindow *window);
-GLFWwindow *initWindow();
+GLFWwindow *initWindow(unsigned int width, unsigned int height);
 
 const unsigned int WIN_WIDTH = 800;
 const unsigned int WIN_HEIGHT = 600;
 
+// simulated seconds per headless frame
+const float HEADLESS_TIMESTEP = 1.0f / 60.0f;
+
 float deltaTime = 0.0f;
 float lastFrame = 0.0f;
 
 bool firstMouse = false;
+bool pickRequested = false;
 
 Camera camera(glm::vec3(0, 0, 3.0f));
 
-int main() {
-  GLFWwindow *window = initWindow();
-
-  if (window == NULL) {
-    std::cout << "Failed to create GLFW window" << std::endl;
-    glfwTerminate();
+// what the command line asks for, see parseOptions()
+struct Options {
+  bool headless;
+  unsigned int width, height;
+  unsigned int frames; // headless only, the window runs until it is closed
+  std::string root;
+  std::string trace; // Chrome trace of every frame, written at exit when set
+  std::string capture; // file pattern or command frames are captured to, nothing captured when empty
+  CaptureFormat captureFormat;
+  unsigned int captureInterval;
+};
+
+static bool parseOptions(int argc, char **argv, Options &options);
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!parseOptions(argc, argv, options))
     return -1;
-  }
 
-  glfwMakeContextCurrent(window);
-  glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
+  GLFWwindow *window = NULL;
+  HeadlessContext headless;
+  if (options.headless) {
+    if (!headless.create(options.width, options.height))
+      return -1;
+  } else {
+    window = initWindow(options.width, options.height);
+
+    if (window == NULL) {
+      std::cout << "Failed to create GLFW window" << std::endl;
+      glfwTerminate();
+      return -1;
+    }
 
-  // initialize GLAD before calling any OpenGL function
-  if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-    std::cout << "Failed to initialize GLAD" << std::endl;
-    return -1;
-  }
+    glfwMakeContextCurrent(window);
+    glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-  Shader defaultShader("/Users/caio/Development/opengl/src/shaders/default/vertex.glsl", "/Users/caio/Development/opengl/src/shaders/default/fragment.glsl");
-  Texture woodTexture("/Users/caio/Development/opengl/src/assets/container.png", GL_RGB);
-  Texture awesomeTexture("/Users/caio/Development/opengl/src/assets/awesome.png", GL_RGBA);
+    // initialize GLAD before calling any OpenGL function
+    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+      std::cout << "Failed to initialize GLAD" << std::endl;
+      return -1;
+    }
+    GLExtensions::load((GLADloadproc)glfwGetProcAddress);
+  }
 
-  CubeModel cube(&defaultShader, woodTexture.ID, awesomeTexture.ID);
+  // transforms, culling and the instance data are built on a few cores, the GL calls stay on this thread
+  JobSystem jobs(CubeScene::jobThreads());
 
-  // world space positions of our cubes
-  glm::vec3 cubePositions[] = {glm::vec3(0.0f, 0.0f, 0.0f),   glm::vec3(2.0f, 5.0f, -15.0f), glm::vec3(-1.5f, -2.2f, -2.5f), glm::vec3(-3.8f, -2.0f, -12.3f),
-                               glm::vec3(2.4f, -0.4f, -3.5f), glm::vec3(-1.7f, 3.0f, -7.5f), glm::vec3(1.3f, -2.0f, -2.5f),  glm::vec3(1.5f, 2.0f, -2.5f),
-                               glm::vec3(1.5f, 0.2f, -1.5f),  glm::vec3(-1.3f, 1.0f, -1.5f)};
+  CubeScene scene(options.root, jobs);
+  camera.SetPerspective((float)options.width / (float)options.height, 0.1f, 100.0f);
 
-  glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-  glfwSetCursorPosCallback(window, mouseCallback);
-  glfwSetScrollCallback(window, scrollCallback);
+  if (window != NULL) {
+    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+    glfwSetCursorPosCallback(window, mouseCallback);
+    glfwSetScrollCallback(window, scrollCallback);
+    glfwSetMouseButtonCallback(window, mouseButtonCallback);
+  } else {
+    // a batch render must not depend on how fast the textures happen to load
+    scene.finishLoading();
+  }
   glEnable(GL_DEPTH_TEST);
 
-  const float radius = 10.0f;
+  // CPU and GPU time of the scopes in CubeScene::renderFrame
+  Profiler profiler(!options.trace.empty());
+  Profiler::current = &profiler;
+
+  // reads back what is drawn: the back buffer of the window or the headless target
+  FrameCapture capture;
+  int captureWidth = options.width, captureHeight = options.height;
+  if (!options.capture.empty()) {
+    if (window != NULL)
+      glfwGetFramebufferSize(window, &captureWidth, &captureHeight); // larger than the window on high DPI screens
+    if (!capture.start(captureWidth, captureHeight, options.captureFormat, options.capture, options.captureInterval))
+      std::cout << "ERROR::CAPTURE::NOT_STARTED " << options.capture << std::endl;
+  }
+
+  float lastStatsTime = 0.0f;
+  unsigned int frame = 0;
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 
-  // render loop
-  while (!glfwWindowShouldClose(window)) {
-    GLfloat currentFrame = glfwGetTime();
+  // render loop, the same for both: only the clock, the input and the presentation differ
+  while (window != NULL ? !glfwWindowShouldClose(window) : frame < options.frames) {
+    // headless frames advance by a fixed step, so a batch render comes out the same however long the frames take
+    float currentFrame = window != NULL ? (float)glfwGetTime() : frame * HEADLESS_TIMESTEP;
     deltaTime = currentFrame - lastFrame;
     lastFrame = currentFrame;
 
-    processInput(window);
-
-    defaultShader.use();
+    if (window != NULL)
+      processInput(window);
 
-    // rendering
-    glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    profiler.beginFrame();
+    scene.renderFrame(camera, currentFrame, deltaTime);
 
-    glm::mat4 view = glm::mat4(1.0f);
-    glm::mat4 projection = glm::mat4(1.0f);
+    // the cursor is captured, so picking goes through the center of the screen
+    if (pickRequested) {
+      RayHit hit;
+      if (scene.pick(camera, hit))
+        std::cout << "PICK::CUBE " << hit.object << " DISTANCE " << hit.distance << std::endl;
+      else
+        std::cout << "PICK::NONE" << std::endl;
+      pickRequested = false;
+    }
 
-    view = camera.GetViewMatrix();
-    projection = glm::perspective(glm::radians(camera.Zoom), (float)WIN_WIDTH / (float)WIN_HEIGHT, 0.1f, 100.0f);
+    {
+      ProfileScope scope("capture");
+      if (window != NULL && capture.active())
+        glfwGetFramebufferSize(window, &captureWidth, &captureHeight);
+      capture.capture(frame, captureWidth, captureHeight);
+    }
+    profiler.endFrame();
 
-    defaultShader.setMat4("view", view);
-    defaultShader.setMat4("projection", projection);
+    if (window != NULL) {
+      glfwSwapBuffers(window); // this will swap the color buffer used to render and show it as output to the screen
+      glfwPollEvents();        // this checks if any events are triggered, updates the window state and execute callbacks
+    }
+    frame++;
+
+    // report the last frame's counters once per second
+    if (currentFrame - lastStatsTime >= 1.0f) {
+      scene.printStats();
+      profiler.printLastFrame();
+      capture.printStats();
+      lastStatsTime = currentFrame;
+    }
+    scene.resetFrameStats();
+  }
 
-    for (unsigned int i = 0; i < 10; i++) {
-      glm::mat4 model = glm::mat4(1.0f);
-      model = glm::translate(model, cubePositions[i]);
+  capture.stop();
+  if (window == NULL) {
+    glFinish();
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "HEADLESS::RENDERED " << frame << " FRAMES AT " << options.width << "x" << options.height << " IN " << seconds * 1000.0 << " ms" << std::endl;
+  }
 
-      float angle = 20.0f * i;
+  if (!options.trace.empty()) {
+    profiler.finish();
+    profiler.writeTrace(options.trace.c_str());
+  }
 
-      // if (i % 3 == 0) {
-      //   angle = currentFrame * 25.0f;
-      // }
+  profiler.destroy();
+  scene.destroy();
+  if (window != NULL)
+    glfwTerminate();
+  else
+    headless.destroy();
+  return 0;
+}
 
-      model = glm::rotate(model, glm::radians(angle), glm::vec3(1.0f, 0.3f, 0.5f));
-      defaultShader.setMat4("model", model);
-      cube.render();
+/*
+ main [--headless] [--size WIDTHxHEIGHT] [--frames N] [--root DIR] [--trace FILE]
+      [--capture PATTERN | --capture-pipe COMMAND] [--capture-every N]
+ --headless renders N frames (60 by default) into an offscreen framebuffer without a window, root is the directory
+ holding shaders/ and assets/, with a trailing slash. --trace writes the profiled scopes of every frame to FILE as
+ Chrome trace JSON, for chrome://tracing or ui.perfetto.dev.
+ --capture saves every N-th frame (every frame by default) to the file the printf PATTERN makes of the frame number,
+ as PNG, or QOI when the pattern ends in .qoi: --capture frames/%05u.png. --capture-pipe writes the frames as raw
+ RGBA8 to the standard input of COMMAND instead, e.g. "ffmpeg -f rawvideo -pix_fmt rgba -s 800x600 -r 60 -i - out.mp4"
+*/
+static bool parseOptions(int argc, char **argv, Options &options) {
+  options.headless = false;
+  options.width = WIN_WIDTH;
+  options.height = WIN_HEIGHT;
+  options.frames = 60;
+  options.root = DEFAULT_SOURCE_ROOT;
+  options.captureFormat = CAPTURE_PNG;
+  options.captureInterval = 1;
+
+  for (int i = 1; i < argc; i++) {
+    bool hasValue = i + 1 < argc;
+    if (strcmp(argv[i], "--headless") == 0) {
+      options.headless = true;
+    } else if (strcmp(argv[i], "--size") == 0 && hasValue) {
+      if (sscanf(argv[++i], "%ux%u", &options.width, &options.height) != 2 || options.width == 0 || options.height == 0) {
+        std::cout << "ERROR::OPTIONS::INVALID_SIZE " << argv[i] << std::endl;
+        return false;
+      }
+    } else if (strcmp(argv[i], "--frames") == 0 && hasValue) {
+      options.frames = (unsigned int)atoi(argv[++i]);
+    } else if (strcmp(argv[i], "--root") == 0 && hasValue) {
+      options.root = argv[++i];
+      if (options.root.empty() || options.root[options.root.size() - 1] != '/')
+        options.root += '/';
+    } else if (strcmp(argv[i], "--trace") == 0 && hasValue) {
+      options.trace = argv[++i];
+    } else if (strcmp(argv[i], "--capture") == 0 && hasValue) {
+      options.capture = argv[++i];
+      size_t length = options.capture.size();
+      options.captureFormat = length >= 4 && options.capture.compare(length - 4, 4, ".qoi") == 0 ? CAPTURE_QOI : CAPTURE_PNG;
+    } else if (strcmp(argv[i], "--capture-pipe") == 0 && hasValue) {
+      options.capture = argv[++i];
+      options.captureFormat = CAPTURE_PIPE;
+    } else if (strcmp(argv[i], "--capture-every") == 0 && hasValue) {
+      options.captureInterval = (unsigned int)atoi(argv[++i]);
+    } else {
+      std::cout << "ERROR::OPTIONS::UNKNOWN " << argv[i] << std::endl;
+      std::cout << "usage: main [--headless] [--size WIDTHxHEIGHT] [--frames N] [--root DIR] [--trace FILE] [--capture PATTERN | --capture-pipe COMMAND] [--capture-every N]"
+                << std::endl;
+      return false;
     }
-
-    glfwSwapBuffers(window); // this will swap the color buffer used to render and show it as output to the screen
-    glfwPollEvents();        // this checks if any events are triggered, updates the window state and execute callbacks
   }
-
-  cube.destroy();
-  glDeleteProgram(defaultShader.ID);
-  glfwTerminate();
-  return 0;
+  return true;
 }
 
-void framebufferSizeCallback(GLFWwindow *window, int width, int height) { glViewport(0, 0, width, height); }
+void framebufferSizeCallback(GLFWwindow *window, int width, int height) {
+  glViewport(0, 0, width, height);
+  if (height > 0)
+    camera.SetAspect((float)width / (float)height);
+}
 
 float lastX = 400, lastY = 300;
 
@@ -153,7 +289,12 @@ void scrollCallback(GLFWwindow *window, double xoffset, double yoffset) {
   camera.ProcessMouseScroll((float)yoffset);
 }
 
-GLFWwindow *initWindow() {
+void mouseButtonCallback(GLFWwindow *window, int button, int action, int mods) {
+  if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS)
+    pickRequested = true;
+}
+
+GLFWwindow *initWindow(unsigned int width, unsigned int height) {
   // initialize GLFW
   glfwInit();
   glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -165,6 +306,6 @@ GLFWwindow *initWindow() {
 #endif
 
   // initialize window
-  GLFWwindow *window = glfwCreateWindow(WIN_WIDTH, WIN_HEIGHT, "HELLO WORLD", NULL, NULL);
+  GLFWwindow *window = glfwCreateWindow(width, height, "HELLO WORLD", NULL, NULL);
   return window;
 }
\ No newline at end of file
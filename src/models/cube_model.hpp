@@ -4,8 +4,17 @@
 #include <glad/glad.h>
 
 #include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <deque>
+#include <iostream>
+#include <map>
 
+#include "../classes/gl_state_cache.h"
+#include "../classes/job_system.h"
+#include "../classes/mesh_builder.h"
+#include "../classes/render_queue.h"
 #include "../classes/shader.h"
+#include "../classes/vertex_format.h"
 
 class CubeModel {
 public:
@@ -32,49 +41,281 @@ public:
 
   unsigned int VAO;
   unsigned int VBO;
+  unsigned int EBO;
+
+  // vertices above welded into unique corners, drawn through EBO
+  GLsizei indexCount;
+  GLenum indexType;
+
+  // packed layout of the uploaded vertices, picked per mesh by the quantization error
+  VertexFormat format;
+
+  // second VAO sharing VBO, plus a buffer with one model matrix per instance
+  unsigned int instanceVAO;
+  unsigned int instanceVBO;
+  size_t instanceCapacity;
+
+  // what submitInstanced() queued this frame, gathered into instanceVBO when the queue executes the draw. A deque, so
+  // the commands can point at the batches while more are added
+  struct InstanceBatch {
+    const glm::mat4 *models;
+    const uint32_t *indices;
+    JobSystem *jobs;
+  };
+  std::deque<InstanceBatch> batches;
+  unsigned int batchFrame;
 
   Shader *shader;
+  Shader *instancedShader;
   unsigned int texture1;
   unsigned int texture2;
 
-  CubeModel(Shader *shader, unsigned int t1, unsigned int t2) : shader(shader), texture1(t1), texture2(t2) {
+  // sampler uniform handles, resolved once
+  int texture1Handle;
+  int texture2Handle;
+  int instancedTexture1Handle;
+  int instancedTexture2Handle;
+
+  // positionScale, positionBias, texCoordScale, texCoordBias
+  int dequantizeHandles[4];
+  int instancedDequantizeHandles[4];
+
+  // what this model registered in a RenderQueue with addTo()
+  uint16_t queueProgram, queueInstancedProgram, queueTextures, queueMesh, queueInstancedMesh;
+
+  CubeModel(Shader *shader, unsigned int t1, unsigned int t2, Shader *instancedShader = NULL)
+      : instanceCapacity(0), batchFrame(0), shader(shader), instancedShader(instancedShader), texture1(t1), texture2(t2) {
+    texture1Handle = shader->getUniformHandle("texture1");
+    texture2Handle = shader->getUniformHandle("texture2");
+    instancedTexture1Handle = instancedShader ? instancedShader->getUniformHandle("texture1") : -1;
+    instancedTexture2Handle = instancedShader ? instancedShader->getUniformHandle("texture2") : -1;
+    resolveDequantizeHandles(shader, dequantizeHandles);
+    resolveDequantizeHandles(instancedShader, instancedDequantizeHandles);
+
+    // samplers are program state and never change, set once like RenderQueue::addProgram does
+    shader->use();
+    shader->setInt(texture1Handle, 0);
+    shader->setInt(texture2Handle, 1);
+    if (instancedShader != NULL) {
+      instancedShader->use();
+      instancedShader->setInt(instancedTexture1Handle, 0);
+      instancedShader->setInt(instancedTexture2Handle, 1);
+    }
+
+    IndexedMesh mesh = buildIndexedMesh("cube", vertices, 36, 5);
+    indexCount = (GLsizei)mesh.indices.size();
+    indexType = mesh.indexType();
+
+    // positions within a thousandth of a unit, texture coordinates within a quarter texel of a 1024 texture
+    const unsigned int locations[] = {0, 1};
+    const unsigned int components[] = {3, 2};
+    const float tolerances[] = {0.001f, 0.25f / 1024.0f};
+    format = chooseVertexFormat("cube", mesh.vertices.data(), mesh.vertexCount(), locations, components, tolerances, 2);
+    std::vector<unsigned char> packed = format.pack(mesh.vertices.data(), mesh.vertexCount());
+
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
+    glGenBuffers(1, &EBO);
 
     /*
      The Vertex Array Object (VAO) is bound like the Vertex Buffer Object (VBO).
      Any vertex attribute calls after the bound will be stored inside the VAO.
      Because of this, whe bind the VAO before the VBO
   */
-    glBindVertexArray(VAO);                                                        // 1. bind VAO first
+    GLStateCache::bindVertexArray(VAO);                                            // 1. bind VAO first
     glBindBuffer(GL_ARRAY_BUFFER, VBO);                                            // 2. bind VBO to GL_ARRAY_BUFFER
-    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);     // 3. set vertex data to the buffer
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)0); // 4. configure vertex attributes
-    glEnableVertexAttribArray(0);                                                  // 5. enable vertex attribute at location 0
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void *)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
+    glBufferData(GL_ARRAY_BUFFER, packed.size(), packed.data(), GL_STATIC_DRAW);   // 3. set vertex data to the buffer
+    format.apply();                                                                // 4. configure and enable the vertex attributes
+
+    // the element buffer binding is part of the VAO state, so it has to be bound while each VAO is
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    if (mesh.fitsShortIndices()) {
+      std::vector<uint16_t> shortIndices = mesh.shortIndices();
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+    } else {
+      glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(uint32_t), mesh.indices.data(), GL_STATIC_DRAW);
+    }
+
+    /*
+     The instanced VAO reads the same vertices, and a mat4 per instance from instanceVBO.
+     A mat4 attribute takes 4 consecutive locations (one vec4 column each), and a divisor
+     of 1 advances it once per instance instead of once per vertex.
+    */
+    glGenVertexArrays(1, &instanceVAO);
+    glGenBuffers(1, &instanceVBO);
+
+    GLStateCache::bindVertexArray(instanceVAO);
+    format.apply(); // VBO is still bound to GL_ARRAY_BUFFER
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    for (unsigned int i = 0; i < 4; i++) {
+      glVertexAttribPointer(2 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void *)(i * sizeof(glm::vec4)));
+      glEnableVertexAttribArray(2 + i);
+      glVertexAttribDivisor(2 + i, 1);
+    }
 
-    glBindVertexArray(0);
+    GLStateCache::bindVertexArray(0);
   }
 
   void render() {
     shader->use();
-    shader->setInt("texture1", 0);
-    shader->setInt("texture2", 1);
+    setDequantization(shader, dequantizeHandles);
+
+    GLStateCache::bindVertexArray(VAO);
+    GLStateCache::bindTexture(0, texture1);
+    GLStateCache::bindTexture(1, texture2);
+
+    glDrawElements(GL_TRIANGLES, indexCount, indexType, (void *)0);
+  }
+
+  // draws one cube per model matrix with a single draw call, using instancedShader
+  void renderInstanced(const glm::mat4 *models, size_t count) {
+    if (count == 0 || !hasInstancedShader())
+      return;
+
+    // orphan the old storage so the driver does not have to wait for the previous frame's draw to finish reading it
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (count > instanceCapacity)
+      instanceCapacity = count;
+    glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), models);
+
+    drawInstances(count);
+  }
+
+  // the same for the cubes listed in indices, their matrices are gathered from models straight into the mapped instance
+  // buffer, by all threads of jobs when there are enough of them. Only the map and the draw are GL calls
+  void renderInstanced(const glm::mat4 *models, const uint32_t *indices, size_t count, JobSystem *jobs = NULL) {
+    if (hasInstancedShader() && uploadInstances(models, indices, count, jobs))
+      drawInstances(count);
+  }
 
-    glBindVertexArray(VAO);
+  // registers both programs, the textures and both VAOs, once per queue
+  void addTo(RenderQueue &queue) {
+    const char *const samplers[] = {"texture1", "texture2"};
+    const unsigned int textures[] = {texture1, texture2};
+    queueProgram = queue.addProgram(shader, samplers, 2);
+    queueInstancedProgram = instancedShader ? queue.addProgram(instancedShader, samplers, 2) : 0;
+    queueTextures = queue.addTextureSet(textures, 2);
+    queueMesh = queue.addMesh(VAO, indexCount, indexType, &CubeModel::setMeshUniforms, this);
+    queueInstancedMesh = queue.addMesh(instanceVAO, indexCount, indexType, &CubeModel::setMeshUniforms, this, &CubeModel::fillInstances);
+  }
 
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture1);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, texture2);
+  // queues one cube, model has to stay valid until the queue executes
+  void submit(RenderQueue &queue, const glm::mat4 *model, float depth) { queue.submit(RENDER_PASS_OPAQUE, queueProgram, queueTextures, queueMesh, depth, model); }
 
-    glDrawArrays(GL_TRIANGLES, 0, 36);
+  // queues the draw of renderInstanced(), the instance buffer is filled when the queue executes it so several batches
+  // can be queued in one frame. models and indices have to stay valid until then
+  void submitInstanced(RenderQueue &queue, const glm::mat4 *models, const uint32_t *indices, size_t count, float depth, JobSystem *jobs = NULL) {
+    if (count == 0 || !hasInstancedShader())
+      return;
+    if (batchFrame != queue.frame()) {
+      batches.clear();
+      batchFrame = queue.frame();
+    }
+    InstanceBatch batch = {models, indices, jobs};
+    batches.push_back(batch);
+    queue.submit(RENDER_PASS_OPAQUE, queueInstancedProgram, queueTextures, queueInstancedMesh, depth, NULL, (uint32_t)count, &batches.back());
   }
 
   void destroy() {
+    GLStateCache::forgetVertexArray(VAO);
+    GLStateCache::forgetVertexArray(instanceVAO);
     glDeleteVertexArrays(1, &VAO);
-    glDeleteVertexArrays(1, &VBO);
+    glDeleteVertexArrays(1, &instanceVAO);
+    glDeleteBuffers(1, &VBO);
+    glDeleteBuffers(1, &EBO);
+    glDeleteBuffers(1, &instanceVBO);
+
+    // a model or program made later at the same address has to set its uniforms again
+    if (dequantizedBy(shader) == this)
+      dequantizedBy(shader) = NULL;
+    if (instancedShader != NULL && dequantizedBy(instancedShader) == this)
+      dequantizedBy(instancedShader) = NULL;
+  }
+
+private:
+  // the instanced paths need the program the constructor made optional
+  bool hasInstancedShader() const {
+    if (instancedShader == NULL)
+      std::cout << "ERROR::CUBE_MODEL::NO_INSTANCED_SHADER" << std::endl;
+    return instancedShader != NULL;
+  }
+
+  bool uploadInstances(const glm::mat4 *models, const uint32_t *indices, size_t count, JobSystem *jobs) {
+    if (count == 0)
+      return false;
+
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    if (count > instanceCapacity) {
+      instanceCapacity = count;
+      glBufferData(GL_ARRAY_BUFFER, instanceCapacity * sizeof(glm::mat4), NULL, GL_STREAM_DRAW);
+    }
+    // invalidating orphans the storage like glBufferData above
+    glm::mat4 *instances = (glm::mat4 *)glMapBufferRange(GL_ARRAY_BUFFER, 0, count * sizeof(glm::mat4), GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (instances == NULL)
+      return false;
+    if (jobs != NULL && count >= 4096) {
+      jobs->parallelFor((uint32_t)count, 1024, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++)
+          instances[i] = models[indices[i]];
+      });
+    } else {
+      for (size_t i = 0; i < count; i++)
+        instances[i] = models[indices[i]];
+    }
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+    return true;
+  }
+
+  void drawInstances(size_t count) {
+    if (!hasInstancedShader())
+      return;
+    instancedShader->use();
+    setDequantization(instancedShader, instancedDequantizeHandles);
+
+    GLStateCache::bindVertexArray(instanceVAO);
+    GLStateCache::bindTexture(0, texture1);
+    GLStateCache::bindTexture(1, texture2);
+
+    glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (void *)0, (GLsizei)count);
+  }
+
+  void resolveDequantizeHandles(Shader *program, int *handles) {
+    const char *names[] = {"positionScale", "positionBias", "texCoordScale", "texCoordBias"};
+    for (int i = 0; i < 4; i++)
+      handles[i] = program ? program->getUniformHandle(names[i]) : -1;
+  }
+
+  static bool fillInstances(const void *instances, uint32_t instanceCount, const void *user) {
+    const InstanceBatch &batch = *(const InstanceBatch *)instances;
+    return ((CubeModel *)user)->uploadInstances(batch.models, batch.indices, instanceCount, batch.jobs);
+  }
+
+  static void setMeshUniforms(Shader &program, const void *user) {
+    const CubeModel &model = *(const CubeModel *)user;
+    model.setDequantization(&program, &program == model.shader ? model.dequantizeHandles : model.instancedDequantizeHandles);
+  }
+
+  // the model whose dequantization each program holds, so the four uniforms are only set again when another model
+  // draws with the program in between
+  static const CubeModel *&dequantizedBy(const Shader *program) {
+    static std::map<const Shader *, const CubeModel *> holders;
+    return holders[program];
+  }
+
+  void setDequantization(Shader *program, const int *handles) const {
+    const CubeModel *&holder = dequantizedBy(program);
+    if (holder == this)
+      return;
+    holder = this;
+    const VertexAttribute &position = format.attributes[0];
+    const VertexAttribute &texCoord = format.attributes[1];
+    program->setVec3(handles[0], glm::vec3(position.scale));
+    program->setVec3(handles[1], glm::vec3(position.bias));
+    program->setVec2(handles[2], glm::vec2(texCoord.scale.x, texCoord.scale.y));
+    program->setVec2(handles[3], glm::vec2(texCoord.bias.x, texCoord.bias.y));
   }
 };
 
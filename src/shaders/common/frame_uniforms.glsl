@@ -0,0 +1,9 @@
+// per frame camera data, one uniform buffer shared by every program (FrameUniformData in frame_uniforms.hpp)
+layout (std140) uniform FrameUniforms {
+  mat4 view;
+  mat4 projection;
+  mat4 viewProjection;
+  vec4 cameraPosition; // w unused
+  float time;
+  float deltaTime;
+};
\ No newline at end of file
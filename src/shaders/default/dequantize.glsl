@@ -0,0 +1,5 @@
+// dequantization of compact vertex formats, identity for float attributes
+uniform vec3 positionScale = vec3(1.0f);
+uniform vec3 positionBias = vec3(0.0f);
+uniform vec2 texCoordScale = vec2(1.0f);
+uniform vec2 texCoordBias = vec2(0.0f);
\ No newline at end of file
@@ -1,12 +1,24 @@
 #version 330 core
 
 in vec2 TexCoord;
+#ifdef VERTEX_COLOR
+in vec3 VertexColor;
+#endif
 
 out vec4 FragColor;
 
 uniform sampler2D texture1;
+#ifdef TEXTURE2_BLEND
 uniform sampler2D texture2;
+#endif
 
 void main() {
+#ifdef TEXTURE2_BLEND
   FragColor = mix(texture(texture1, TexCoord), texture(texture2, TexCoord), 0.2f);
+#else
+  FragColor = texture(texture1, TexCoord);
+#endif
+#ifdef VERTEX_COLOR
+  FragColor.rgb *= VertexColor;
+#endif
 }
\ No newline at end of file
@@ -1,14 +1,32 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec2 aTexPos;
+#ifdef INSTANCED
+layout (location = 2) in mat4 aModel; // per instance, takes locations 2 to 5
+#endif
+#ifdef VERTEX_COLOR
+layout (location = 6) in vec3 aColor;
+#endif
 
 out vec2 TexCoord;
+#ifdef VERTEX_COLOR
+out vec3 VertexColor;
+#endif
 
+#include "dequantize.glsl"
+#include "../common/frame_uniforms.glsl"
+
+#ifndef INSTANCED
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+#endif
 
 void main() {
-  gl_Position = projection * view * model * vec4(aPos, 1.0f);
-  TexCoord = aTexPos;
+#ifdef INSTANCED
+  mat4 model = aModel;
+#endif
+  gl_Position = viewProjection * model * vec4(aPos * positionScale + positionBias, 1.0f);
+  TexCoord = aTexPos * texCoordScale + texCoordBias;
+#ifdef VERTEX_COLOR
+  VertexColor = aColor;
+#endif
 }
\ No newline at end of file